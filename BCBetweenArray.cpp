@@ -30,8 +30,14 @@
 
 #include "BCBetweenArray.h"
 #include <system/Exceptions.h>
+#include <array/RLE.h>
 #include <util/SpatialType.h>
 #include <system/Utils.h>
+#include <smgr/io/InternalStorage.h>
+#include <MurmurHash/MurmurHash3.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace scidb
 {
@@ -72,18 +78,26 @@ namespace scidb
             iterationMode &= ~ChunkIterator::TILE_MODE;
         }
         iterationMode &= ~ChunkIterator::INTENDED_TILE_MODE;
+        BCBetweenTrace::Span span(_array._trace.get(), "construct chunk iterator", getFirstPosition(false), attrID);
+        if (_fullBitmap)
+        {
+            return _fullBitmap->getConstIterator(iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES);
+        }
         return std::shared_ptr<ConstChunkIterator>(
                 attr.isEmptyIndicator()
                 ? (attrID >= _array.getInputArray()->getArrayDesc().getAttributes().size())
-                  ? _fullyInside
-                    ? (ConstChunkIterator*)new EmptyBitmapBCBetweenChunkIterator(arrayIterator, *this, iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES)
-                    : (ConstChunkIterator*)new NewBitmapBCBetweenChunkIterator(arrayIterator, *this, iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES)
+                  ? (ConstChunkIterator*)new NewBitmapBCBetweenChunkIterator(arrayIterator, *this, iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES)
                   : _fullyInside
                     ? (ConstChunkIterator*)new DelegateChunkIterator(this, iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES)
                     : (ConstChunkIterator*)new ExistedBitmapBCBetweenChunkIterator(arrayIterator, *this, iterationMode & ~ConstChunkIterator::IGNORE_DEFAULT_VALUES)
                 : _fullyInside
                   ? (ConstChunkIterator*)new DelegateChunkIterator(this, iterationMode)
-                  : (ConstChunkIterator*)new BCBetweenChunkIterator(arrayIterator, *this, iterationMode));
+                  : (ConstChunkIterator*)new DataBCBetweenChunkIterator(arrayIterator, *this, iterationMode));
+    }
+
+    ConstChunk* BCBetweenChunk::materialize() const
+    {
+        return _fullBitmap ? _fullBitmap.get() : DelegateChunk::materialize();
     }
 
     BCBetweenChunk::BCBetweenChunk(BCBetweenArray const& arr, DelegateArrayIterator const& iterator, AttributeID attrID)
@@ -91,7 +105,9 @@ namespace scidb
               _array(arr),
               _myRange(arr.getArrayDesc().getDimensions().size()),
               _fullyInside(false),
-              _fullyOutside(false)
+              _fullyOutside(false),
+              _shellDecided(false),
+              _shellPasses(false)
     {
         tileMode = false;
     }
@@ -105,11 +121,50 @@ namespace scidb
         // TO-DO: the _fullyInside computation is simple but not optimal.
         // It is possible that the current _chunk is fully inside the union of the specified ranges,
         // although not fully contained in any of them.
+        // A sampled chunk is never passed through, even when it is fully inside.
         size_t dummy = 0;
-        _fullyInside = _array._innerSpatialRnagesPtr->findOneThatContains(_myRange, dummy);
-        _fullyOutside = !_array._spatialRangesPtr->findOneThatIntersects(_myRange, dummy);
+        bool insideInner = _array._innerSpatialRnagesPtr->findOneThatContains(_myRange, dummy);
+        bool outsideOuter = !_array._spatialRangesPtr->findOneThatIntersects(_myRange, dummy);
+        // A sampled or limited chunk is never passed through either.
+        _fullyInside = !_array._sampled && !_array._limit && (_array._complement ? outsideOuter : insideInner);
+        _fullyOutside = _array._complement ? insideInner : outsideOuter;
+
+        // When the zone map decides the shell, it behaves as the inner window or as the outside, and the
+        // chunk is passed through or dropped when that holds for all of it.
+        _shellDecided = !_fullyInside && !_fullyOutside && _array._zoneMap &&
+                        _array.decideShell((BCBetweenArrayIterator const&)getArrayIterator(), inputChunk, _shellPasses);
+        if (_shellDecided)
+        {
+            bool selected = _shellPasses != _array._complement;
+            bool insideOuter = _array._spatialRangesPtr->findOneThatContains(_myRange, dummy);
+            bool outsideInner = !_array._innerSpatialRnagesPtr->findOneThatIntersects(_myRange, dummy);
+            if (selected)
+            {
+                _fullyInside = !_array._sampled && !_array._limit && (_array._complement ? outsideInner : insideOuter);
+            } else
+            {
+                _fullyOutside = _array._complement ? insideOuter : outsideInner;
+            }
+        }
+
+        if (_array._stats)
+        {
+            if (_shellDecided)
+            {
+                _array._stats->add(BCBetweenStats::CHUNKS_ZONE_DECIDED, 1);
+            }
+            _array._stats->add(BCBetweenStats::CHUNKS_VISITED, 1);
+            _array._stats->add(_fullyInside ? BCBetweenStats::CHUNKS_FULLY_INSIDE
+                               : _fullyOutside ? BCBetweenStats::CHUNKS_FULLY_OUTSIDE
+                               : BCBetweenStats::CHUNKS_PARTIAL, 1);
+        }
 
         isClone = _fullyInside && attrID < _array.getInputArray()->getArrayDesc().getAttributes().size();
+        _fullBitmap.reset();
+        if (_fullyInside && attrID >= _array.getInputArray()->getArrayDesc().getAttributes().size())
+        {
+            _fullBitmap = _array.getFullBitmapChunk(inputChunk);
+        }
         if (_emptyBitmapIterator)
         {
             if (!_emptyBitmapIterator->setPosition(inputChunk.getFirstPosition(false)))
@@ -125,7 +180,13 @@ namespace scidb
             {
                 case BindInfo::BI_ATTRIBUTE:
                 {
-                    _params[i] = _iterators[i]->getItem();
+                    if (_neighborIterators[i])
+                    {
+                        readNeighbor(i);
+                    } else
+                    {
+                        _params[i] = _iterators[i]->getItem();
+                    }
                     break;
                 }
                 case BindInfo::BI_COORDINATE:
@@ -141,20 +202,167 @@ namespace scidb
         return const_cast<Value&>(_array.expression->evaluate(_params));
     }
 
-    inline bool BCBetweenChunkIterator::filter()
+    inline bool BCBetweenChunkIterator::passes()
+    {
+        if (!_termParams.empty())
+        {
+            return evaluateTerms();
+        }
+        Value const& result = evaluate();
+        return !result.isNull() && result.getBool();
+    }
+
+    bool BCBetweenChunkIterator::timedPasses()
+    {
+        uint64_t start = BCBetweenStats::now();
+        bool passed = passes();
+        _statCounts[BCBetweenStats::EVALUATE_NANOS] += BCBetweenStats::now() - start;
+        return passed;
+    }
+
+    inline bool BCBetweenChunkIterator::evaluateTerm(size_t term)
+    {
+        ExpressionContext& params = *_termParams[term];
+        std::vector<BindInfo> const& bindings = _array._terms[term]->getBindings();
+        std::vector<ssize_t> const& map = _array._termBindings[term];
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            switch (bindings[i].kind)
+            {
+                case BindInfo::BI_ATTRIBUTE:
+                {
+                    params[i] = _iterators[map[i]]->getItem();
+                    break;
+                }
+                case BindInfo::BI_COORDINATE:
+                {
+                    params[i].setInt64(inputIterator->getPosition()[bindings[i].resolvedId]);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        Value const& result = _array._terms[term]->evaluate(params);
+        return !result.isNull() && result.getBool();
+    }
+
+    bool BCBetweenChunkIterator::evaluateTerms()
+    {
+        // A term that fails an 'and', or passes an 'or', decides the chain.
+        bool decisive = !_array._termsAnd;
+        if (_termOrder)
+        {
+            for (size_t term : *_termOrder)
+            {
+                if (evaluateTerm(term) == decisive)
+                {
+                    return decisive;
+                }
+            }
+            return !decisive;
+        }
+
+        // While measuring, every term is evaluated and timed.
+        bool result = !decisive;
+        size_t nTerms = _termParams.size();
+        for (size_t term = 0; term < nTerms; term++)
+        {
+            uint64_t start = BCBetweenStats::now();
+            bool passed = evaluateTerm(term);
+            _termSamples[term * 3] += 1;
+            _termSamples[term * 3 + 1] += passed;
+            _termSamples[term * 3 + 2] += BCBetweenStats::now() - start;
+            if (passed == decisive)
+            {
+                result = decisive;
+            }
+        }
+        if (++_termSampleCount == BCBetweenArray::TERM_SAMPLE_BATCH)
+        {
+            flushTermSamples();
+        }
+        return result;
+    }
+
+    void BCBetweenChunkIterator::flushTermSamples()
     {
+        _termOrder = _array.addTermSamples(_termSamples);
+        std::fill(_termSamples.begin(), _termSamples.end(), 0);
+        _termSampleCount = 0;
+    }
+
+    void BCBetweenChunkIterator::readNeighbor(size_t binding)
+    {
+        Coordinates const& offset = _array._bindingOffsets[binding];
+        Coordinates const& first = _chunk.getInputChunk().getFirstPosition(true);
+        Coordinates const& last = _chunk.getInputChunk().getLastPosition(true);
+        bool inChunk = true;
+        for (size_t d = 0, n = _curPos.size(); d < n; d++)
+        {
+            _neighborPos[d] = _curPos[d] + offset[d];
+            inChunk = inChunk && _neighborPos[d] >= first[d] && _neighborPos[d] <= last[d];
+        }
+
+        if (!inChunk)
+        {
+            _array.getHaloValue(binding, _neighborPos, _params[binding]);
+        } else if (_neighborIterators[binding]->setPosition(_neighborPos))
+        {
+            _params[binding] = _neighborIterators[binding]->getItem();
+        } else
+        {
+            _params[binding].setNull();
+        }
+    }
+
+    inline bool BCBetweenChunkIterator::filter(bool counted)
+    {
+        if (counted && _array._stats)
+        {
+            _statCounts[BCBetweenStats::CELLS_SCANNED]++;
+        }
+
+        if (_visibility)
+        {
+            return BCBetweenMaskCache::test(*_visibility, coord2pos(_curPos));
+        }
+
+        if(_array._sampled && !isSampled())
+        {
+            return false;
+        }
+
         if(_array._innerSpatialRnagesPtr->findOneThatContains(_curPos, _hintForSpatialRanges))
         {
-            return true;
+            return !_array._complement;
         }
 
         if(_array._spatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges))
         {
-            Value const& result = evaluate();
-            return !result.isNull() && result.getBool();
+            if (_chunk._shellDecided)
+            {
+                return _chunk._shellPasses != _array._complement;
+            }
+            if (_shellMask)
+            {
+                return BCBetweenMaskCache::test(*_shellMask, coord2pos(_curPos)) != _array._complement;
+            }
+            if (_array._stats || _array._trace)
+            {
+                bool passed = timedPasses();
+                if (counted)
+                {
+                    _statCounts[BCBetweenStats::SHELL_EVALUATED]++;
+                    _statCounts[BCBetweenStats::SHELL_PASSED] += passed;
+                }
+                return passed != _array._complement;
+            }
+            return passes() != _array._complement;
         }
 
-        return false;
+        return _array._complement;
     }
 
     Value const& BCBetweenChunkIterator::getItem()
@@ -174,7 +382,154 @@ namespace scidb
             throw USER_EXCEPTION(SCIDB_SE_EXECUTION, SCIDB_LE_NO_CURRENT_ELEMENT);
         }
         return inputIterator->isEmpty() ||
-               !_array._spatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges);
+               (_array._complement
+                ? _array._innerSpatialRnagesPtr->findOneThatContains(_curPos, _hintForSpatialRanges)
+                : !_array._spatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges)) ||
+               (_array._sampled && !isSampled());
+    }
+
+    Coordinate BCBetweenChunkIterator::advanceSampler(Coordinates const& pos) const
+    {
+        size_t inner = pos.size() - 1;
+        DimensionDesc const& dim = _array.getArrayDesc().getDimensions()[inner];
+        Coordinate segmentStart = dim.getStartMin() +
+                                  (pos[inner] - dim.getStartMin()) / dim.getChunkInterval() * dim.getChunkInterval();
+        bool sameSegment = !_sampleRow.empty() && _sampleRow[inner] == segmentStart &&
+                           pos[inner] >= _lastSampleCheck &&
+                           std::equal(pos.begin(), pos.begin() + inner, _sampleRow.begin());
+        if (!sameSegment)
+        {
+            // A new segment, or moved backwards; replay the draws from the start of the segment.
+            _sampleRow = pos;
+            _sampleRow[inner] = segmentStart;
+            uint64_t state = _array._sampleSeed;
+            for (size_t i = 0, n = _sampleRow.size(); i < n; i++)
+            {
+                state = fmix(state ^ fmix(_sampleRow[i]));
+            }
+            _sampleState = state;
+            _nextSample = segmentStart + drawSkip();
+        }
+        _lastSampleCheck = pos[inner];
+        while (_nextSample < pos[inner])
+        {
+            _nextSample += 1 + drawSkip();
+        }
+        return _nextSample;
+    }
+
+    position_t BCBetweenChunkIterator::drawSkip() const
+    {
+        // splitmix64 step, then the number of failures before the first success of a Bernoulli(rate) trial.
+        _sampleState += BIG_CONSTANT(0x9e3779b97f4a7c15);
+        uint64_t bits = fmix(_sampleState);
+        double u = ((bits >> 11) + 1) * (1.0 / 9007199254740992.0);   // (0, 1]
+        return static_cast<position_t>(std::floor(std::log(u) / std::log1p(-_array._sampleRate)));
+    }
+
+    inline bool BCBetweenChunkIterator::isSampled() const
+    {
+        return advanceSampler(_curPos) == _curPos.back();
+    }
+
+    void BCBetweenChunkIterator::addChunkIdentity(BCBetweenMaskCache::Hasher& hasher, ConstChunk const& chunk) const
+    {
+        AttributeID attrID = chunk.getAttributeDesc().getId();
+        Coordinates const& chunkPos = chunk.getFirstPosition(false);
+        hasher.add(&attrID, sizeof(attrID));
+        hasher.add(&chunkPos[0], chunkPos.size() * sizeof(Coordinate));
+
+        // A stored chunk is the same as long as its header is: a new version that changes the chunk
+        // writes it again, at another place. Any other chunk is only known to be the same in this version.
+        PersistentChunk const* stored = dynamic_cast<PersistentChunk const*>(&chunk);
+        if (stored)
+        {
+            ChunkHeader const& header = stored->getHeader();
+            hasher.add(&header.arrId, sizeof(header.arrId));
+            hasher.add(&header.pos.dsGuid, sizeof(header.pos.dsGuid));
+            hasher.add(&header.pos.offs, sizeof(header.pos.offs));
+        } else
+        {
+            ArrayID versionID = _array.getInputArray()->getArrayDesc().getId();
+            hasher.add(&versionID, sizeof(versionID));
+        }
+    }
+
+    std::string BCBetweenChunkIterator::getInputDigest(BCBetweenArrayIterator const& arrayIterator) const
+    {
+        BCBetweenMaskCache::Hasher hasher;
+        addChunkIdentity(hasher, arrayIterator.inputIterator->getChunk());
+        for (size_t i = 0, n = _array.bindings.size(); i < n; i++)
+        {
+            if (_array.bindings[i].kind == BindInfo::BI_ATTRIBUTE &&
+                arrayIterator._iterators[i] != arrayIterator.inputIterator)
+            {
+                addChunkIdentity(hasher, arrayIterator._iterators[i]->getChunk());
+            }
+        }
+        return hasher.finish();
+    }
+
+    void BCBetweenChunkIterator::loadShellMask(BCBetweenArrayIterator const& arrayIterator)
+    {
+        Coordinates const& chunkPos = _chunk.getFirstPosition(false);
+        Coordinates const& first = _chunk.getInputChunk().getFirstPosition(true);
+        Coordinates const& last = _chunk.getInputChunk().getLastPosition(true);
+        size_t nBits = 1;
+        for (size_t i = 0, n = first.size(); i < n; i++)
+        {
+            nBits *= last[i] - first[i] + 1;
+        }
+
+        // Another attribute of this chunk may have the mask already.
+        _shellMask = _array._maskCache->find(chunkPos);
+        if (_shellMask)
+        {
+            return;
+        }
+        std::string digest = getInputDigest(arrayIterator);
+        _shellMask = _array._maskCache->load(chunkPos, nBits, digest);
+        if (_shellMask)
+        {
+            return;
+        }
+        BCBetweenTrace::Span span(_array._trace.get(), "shell evaluation", chunkPos, _chunk.getAttributeDesc().getId());
+
+        // The mask is shared by the iterators of every mode, so it is built over every non-empty cell of
+        // the chunk, overlap included, with iterators of its own; those of this iterator are put back after.
+        std::shared_ptr<ConstChunkIterator> modeIterator = inputIterator;
+        std::vector<std::shared_ptr<ConstChunkIterator> > modeIterators(_iterators);
+        inputIterator = _chunk.getInputChunk().getConstIterator(IGNORE_EMPTY_CELLS);
+        for (size_t i = 0, n = _iterators.size(); i < n; i++)
+        {
+            if (_iterators[i])
+            {
+                _iterators[i] = _iterators[i] == modeIterator
+                                ? inputIterator
+                                : _boundChunks[i]->getConstIterator(IGNORE_EMPTY_CELLS);
+            }
+        }
+
+        std::shared_ptr<BCBetweenMask> mask = make_shared<BCBetweenMask>((nBits + 7) / 8, 0);
+        while (!inputIterator->end())
+        {
+            _curPos = inputIterator->getPosition();
+            if (!_array._innerSpatialRnagesPtr->findOneThatContains(_curPos, _hintForSpatialRanges) &&
+                _array._spatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges))
+            {
+                Value const& result = evaluate();
+                if (!result.isNull() && result.getBool())
+                {
+                    BCBetweenMaskCache::set(*mask, coord2pos(_curPos));
+                }
+            }
+            moveNext();
+        }
+        inputIterator = modeIterator;
+        _iterators.swap(modeIterators);
+
+        _shellMask = mask;
+        _array._maskCache->put(chunkPos, digest, _shellMask);
     }
 
     bool BCBetweenChunkIterator::end()
@@ -192,7 +547,7 @@ namespace scidb
         ++(*inputIterator);
         if (!inputIterator->end())
         {
-            for (size_t i = 0, n = _iterators.size(); i < n; i++)
+            for (size_t i = 0, n = _visibility ? 0 : _iterators.size(); i < n; i++)
             {
                 if (_iterators[i] && _iterators[i] != inputIterator)
                 {
@@ -218,7 +573,29 @@ namespace scidb
     {
         while(!inputIterator->end())
         {
-            if(filter())
+            if (_skipRuns && !skipToRun())
+            {
+                break;
+            }
+            if (_array._sampled && !_visibility && _ignoreEmptyCells)
+            {
+                // Jump to the next sampled cell of the row segment, or past the segment, within the row
+                // of the chunk.
+                size_t inner = _curPos.size() - 1;
+                Coordinate sample = advanceSampler(_curPos);
+                if (sample > _curPos[inner])
+                {
+                    Coordinate segmentEnd = _sampleRow[inner] + _array.getArrayDesc().getDimensions()[inner].getChunkInterval();
+                    Coordinates target(_curPos);
+                    target[inner] = std::min(std::min(sample, segmentEnd), _chunk.getLastPosition(true)[inner] + 1);
+                    if (!jumpTo(coord2pos(target)))
+                    {
+                        break;
+                    }
+                    continue;
+                }
+            }
+            if(filter(true))
             {
                 _hasCurrent = true;
                 return;
@@ -235,9 +612,14 @@ namespace scidb
 
     bool BCBetweenChunkIterator::setPosition(Coordinates const& targetPos)
     {
+        if (!_visibility && ++_probes >= VISIBILITY_PROBES)
+        {
+            buildVisibility();
+        }
+
         if(inputIterator->setPosition(targetPos))
         {
-            for (size_t i = 0, n = _iterators.size(); i < n; i++)
+            for (size_t i = 0, n = _visibility ? 0 : _iterators.size(); i < n; i++)
             {
                 if (_iterators[i] && _iterators[i] != inputIterator)
                 {
@@ -246,11 +628,15 @@ namespace scidb
                 }
             }
             _curPos = targetPos;
-            _hasCurrent = filter();
+            _run = 0;
 
+            // nextVisible() filters the cell at targetPos first.
             if (_ignoreEmptyCells)
             {
                 nextVisible();
+            } else
+            {
+                _hasCurrent = filter(true);
             }
             return _hasCurrent;
         } else
@@ -265,7 +651,7 @@ namespace scidb
         inputIterator->restart();
         if (!inputIterator->end())
         {
-            for (size_t i = 0, n = _iterators.size(); i < n; i++)
+            for (size_t i = 0, n = _visibility ? 0 : _iterators.size(); i < n; i++)
             {
                 if (_iterators[i] && _iterators[i] != inputIterator)
                 {
@@ -276,118 +662,486 @@ namespace scidb
             _curPos = inputIterator->getPosition();
         }
 
+        _run = 0;
         nextVisible();
     }
 
-    ConstChunk const& BCBetweenChunkIterator::getChunk()
+    uint64_t BCBetweenChunkIterator::buildVisibility(uint64_t limit)
     {
-        return _chunk;
+        Coordinates const& first = _chunk.getInputChunk().getFirstPosition(true);
+        Coordinates const& last = _chunk.getInputChunk().getLastPosition(true);
+        size_t nBits = 1;
+        for (size_t i = 0, n = first.size(); i < n; i++)
+        {
+            nBits *= last[i] - first[i] + 1;
+        }
+
+        std::shared_ptr<BCBetweenMask> mask = make_shared<BCBetweenMask>((nBits + 7) / 8, 0);
+        inputIterator->restart();
+        for (size_t i = 0, n = _iterators.size(); i < n; i++)
+        {
+            if (_iterators[i] && _iterators[i] != inputIterator)
+            {
+                _iterators[i]->restart();
+            }
+        }
+        _run = 0;
+        uint64_t count = 0;
+        while (!inputIterator->end() && count < limit)
+        {
+            _curPos = inputIterator->getPosition();
+            if (_skipRuns && !skipToRun())
+            {
+                break;
+            }
+            if (filter())
+            {
+                BCBetweenMaskCache::set(*mask, coord2pos(_curPos));
+                count++;
+            }
+            moveNext();
+        }
+        _visibility = mask;
+        return count;
     }
 
-    BCBetweenChunkIterator::BCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator,
-                                                   BCBetweenChunk const& aChunk, int iterationMode)
-            : CoordinatesMapper(aChunk), DelegateChunkIterator(&aChunk, iterationMode),
-              _array(aChunk._array),
-              _chunk(aChunk),
-              _iterators(_array.bindings.size()),
-              _curPos(_array.getArrayDesc().getDimensions().size()),
-              _mode(iterationMode & ~INTENDED_TILE_MODE & ~TILE_MODE),
-              _ignoreEmptyCells((iterationMode & IGNORE_EMPTY_CELLS) == IGNORE_EMPTY_CELLS),
-              _type(_chunk.getAttributeDesc().getType()),
-              _hintForSpatialRanges(0),
-              _params(*_array.expression),
-              _query(Query::getValidQueryPtr(_array._query))
+    void BCBetweenChunkIterator::trimVisibility(uint64_t budget)
     {
-        inputIterator = aChunk.getInputChunk().getConstIterator(iterationMode & ~INTENDED_TILE_MODE);
-
-        for (size_t i = 0, n = _array.bindings.size(); i < n; i++) {
-            switch (_array.bindings[i].kind) {
-                case BindInfo::BI_COORDINATE:
-                {
-                    //  if iterator is tile mode, then do something
-                    break;
-                }
-                case BindInfo::BI_ATTRIBUTE:
+        BCBetweenMask& mask = *_visibility;
+        for (size_t i = 0, n = mask.size(); i < n; i++)
+        {
+            for (size_t bit = 0; bit < 8; bit++)
+            {
+                if ((mask[i] >> bit) & 1)
                 {
-                    if ((AttributeID)_array.bindings[i].resolvedId == arrayIterator._inputAttrID)
+                    if (budget == 0)
                     {
-                        _iterators[i] = inputIterator;
+                        mask[i] &= static_cast<uint8_t>(~(1 << bit));
                     } else
                     {
-                        _iterators[i] = arrayIterator._iterators[i]->getChunk().getConstIterator(IGNORE_EMPTY_CELLS);
+                        budget--;
                     }
-                    break;
-                }
-                case BindInfo::BI_VALUE:
-                {
-                    _params[i] = _array.bindings[i].value;
-                    break;
                 }
-                default:
-                    break;
             }
         }
-
-        restart();
-        nextVisible();
-    }
-
-    //
-    // Exited bitmap _chunk iterator methods
-    //
-    Value const& ExistedBitmapBCBetweenChunkIterator::getItem()
-    {
-        _value.setBool(
-                inputIterator->getItem().getBool() && filter()
-        );
-        return _value;
     }
 
-    ExistedBitmapBCBetweenChunkIterator::ExistedBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode)
-            : BCBetweenChunkIterator(arrayIterator, chunk, iterationMode),
-              _value(TypeLibrary::getType(TID_BOOL))
+    void BCBetweenChunkIterator::addRows(SpatialRanges const& ranges, std::vector<std::pair<position_t, position_t> >& rows) const
     {
-    }
+        bool withOverlap = !(_mode & IGNORE_OVERLAPS);
+        Coordinates const& first = _chunk.getFirstPosition(withOverlap);
+        Coordinates const& last = _chunk.getLastPosition(withOverlap);
+        size_t nDims = first.size();
+        size_t inner = nDims - 1;
 
-    //
-    // New bitmap _chunk iterator methods
-    //
-    Value const& NewBitmapBCBetweenChunkIterator::getItem()
-    {
-        _value.setBool(_array._spatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges));
-        if(_value.getBool())
+        for (SpatialRange const& range : ranges.ranges())
         {
-            return evaluate();
-        }
+            Coordinates low(nDims);
+            Coordinates high(nDims);
+            bool empty = false;
+            for (size_t d = 0; d < nDims; d++)
+            {
+                low[d] = std::max(range._low[d], first[d]);
+                high[d] = std::min(range._high[d], last[d]);
+                empty = empty || low[d] > high[d];
+            }
+            if (empty)
+            {
+                continue;
+            }
 
-        return _value;
-    }
+            // One run per row of the range along the last dimension.
+            Coordinates row(low);
+            while (true)
+            {
+                position_t start = coord2pos(row);
+                rows.push_back(std::make_pair(start, start + high[inner] - low[inner] + 1));
 
-    NewBitmapBCBetweenChunkIterator::NewBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode)
-            : BCBetweenChunkIterator(arrayIterator, chunk, iterationMode),
-              _value(TypeLibrary::getType(TID_BOOL))
-    {
+                size_t d = inner;
+                while (d > 0 && ++row[d - 1] > high[d - 1])
+                {
+                    row[d - 1] = low[d - 1];
+                    d--;
+                }
+                if (d == 0)
+                {
+                    break;
+                }
+            }
+        }
     }
 
-    //
-    // Empty bitmap _chunk iterator methods
-    //
-    Value const& EmptyBitmapBCBetweenChunkIterator::getItem()
+    void BCBetweenChunkIterator::buildRuns()
     {
-        return _value;
+        std::shared_ptr<ConstRLEEmptyBitmap> const& bitmap = _inputBitmap;
+        _skipRuns = _ignoreEmptyCells && bitmap &&
+                    !(_mode & (IGNORE_NULL_VALUES | IGNORE_DEFAULT_VALUES | TILE_MODE));
+        if (!_skipRuns)
+        {
+            return;
+        }
+
+        // The rows of the window, sorted and merged.
+        std::vector<std::pair<position_t, position_t> > rows;
+        addRows(_array._complement ? *_array._innerSpatialRnagesPtr : *_array._spatialRangesPtr, rows);
+        std::sort(rows.begin(), rows.end());
+        std::vector<std::pair<position_t, position_t> > window;
+        for (size_t i = 0, n = rows.size(); i < n; i++)
+        {
+            if (!window.empty() && rows[i].first <= window.back().second)
+            {
+                window.back().second = std::max(window.back().second, rows[i].second);
+            } else
+            {
+                window.push_back(rows[i]);
+            }
+        }
+
+        // In complement mode, the gaps between the rows of the inner window, within the box the input
+        // iterator covers. A gap may still hold overlap cells, which jumpTo() steps over.
+        if (_array._complement)
+        {
+            bool withOverlap = !(_mode & IGNORE_OVERLAPS);
+            std::vector<std::pair<position_t, position_t> > gaps;
+            position_t start = coord2pos(_chunk.getFirstPosition(withOverlap));
+            position_t end = coord2pos(_chunk.getLastPosition(withOverlap)) + 1;
+            for (size_t i = 0, n = window.size(); i < n; i++)
+            {
+                if (window[i].first > start)
+                {
+                    gaps.push_back(std::make_pair(start, window[i].first));
+                }
+                start = window[i].second;
+            }
+            if (end > start)
+            {
+                gaps.push_back(std::make_pair(start, end));
+            }
+            window.swap(gaps);
+        }
+
+        // Intersect with the non-empty segments.
+        _runs.clear();
+        size_t w = 0;
+        for (size_t i = 0, n = bitmap->nSegments(); i < n && w < window.size(); i++)
+        {
+            ConstRLEEmptyBitmap::Segment const& segment = bitmap->getSegment(i);
+            position_t segmentEnd = segment._lPosition + segment._length;
+            while (w < window.size() && window[w].second <= segment._lPosition)
+            {
+                w++;
+            }
+            for (size_t v = w; v < window.size() && window[v].first < segmentEnd; v++)
+            {
+                position_t start = std::max(window[v].first, segment._lPosition);
+                position_t end = std::min(window[v].second, segmentEnd);
+                if (start < end)
+                {
+                    _runs.push_back(std::make_pair(start, end));
+                }
+            }
+        }
+        _run = 0;
+    }
+
+    bool BCBetweenChunkIterator::skipToRun()
+    {
+        position_t pos = coord2pos(_curPos);
+        if (_run > 0 && _runs[_run - 1].second > pos)
+        {
+            _run = 0;
+        }
+        while (true)
+        {
+            while (_run < _runs.size() && _runs[_run].second <= pos)
+            {
+                _run++;
+            }
+            if (_run == _runs.size())
+            {
+                return false;
+            }
+            if (_runs[_run].first <= pos)
+            {
+                return true;
+            }
+
+            // The first cell the input visits may lie past the run, e.g. when the run starts on an overlap.
+            if (!jumpTo(_runs[_run].first))
+            {
+                return false;
+            }
+            pos = coord2pos(_curPos);
+        }
+    }
+
+    bool BCBetweenChunkIterator::findInputPosition(position_t& pos) const
+    {
+        bool withOverlap = !(_mode & IGNORE_OVERLAPS);
+        Coordinates const& first = _chunk.getFirstPosition(withOverlap);
+        Coordinates const& last = _chunk.getLastPosition(withOverlap);
+        size_t nDims = first.size();
+        Coordinates coord(nDims);
+        while (true)
+        {
+            // The smallest position at or after pos within the box.
+            pos2coord(pos, coord);
+            size_t d = 0;
+            while (d < nDims && coord[d] >= first[d] && coord[d] <= last[d])
+            {
+                d++;
+            }
+            if (d < nDims)
+            {
+                bool carry = coord[d] > last[d];
+                for (size_t k = d; k < nDims; k++)
+                {
+                    coord[k] = first[k];
+                }
+                while (carry && d > 0 && ++coord[d - 1] > last[d - 1])
+                {
+                    coord[d - 1] = first[d - 1];
+                    d--;
+                }
+                if (carry && d == 0)
+                {
+                    return false;
+                }
+                pos = coord2pos(coord);
+            }
+            if (!_inputBitmap)
+            {
+                return true;
+            }
+
+            // Then the start of the non-empty segment at or after it.
+            size_t segment = _inputBitmap->findSegment(pos);
+            if (segment == _inputBitmap->nSegments())
+            {
+                return false;
+            }
+            position_t start = _inputBitmap->getSegment(segment)._lPosition;
+            if (start <= pos)
+            {
+                return true;
+            }
+            pos = start;
+        }
     }
 
-    bool EmptyBitmapBCBetweenChunkIterator::isEmpty() const
+    bool BCBetweenChunkIterator::jumpTo(position_t pos)
     {
+        while (findInputPosition(pos))
+        {
+            pos2coord(pos, _curPos);
+            if (inputIterator->setPosition(_curPos))
+            {
+                for (size_t i = 0, n = _visibility ? 0 : _iterators.size(); i < n; i++)
+                {
+                    if (_iterators[i] && _iterators[i] != inputIterator)
+                    {
+                        if (!_iterators[i]->setPosition(_curPos))
+                            throw USER_EXCEPTION(SCIDB_SE_EXECUTION, SCIDB_LE_OPERATION_FAILED) << "setPosition";
+                    }
+                }
+                return true;
+            }
+
+            // A cell the input iterator skips, such as a null under IGNORE_NULL_VALUES.
+            pos++;
+        }
         return false;
     }
 
-    EmptyBitmapBCBetweenChunkIterator::EmptyBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode)
-            : NewBitmapBCBetweenChunkIterator(arrayIterator, chunk, iterationMode)
+    ConstChunk const& BCBetweenChunkIterator::getChunk()
+    {
+        return _chunk;
+    }
+
+    BCBetweenChunkIterator::BCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator,
+                                                   BCBetweenChunk const& aChunk, int iterationMode)
+            : CoordinatesMapper(aChunk), DelegateChunkIterator(&aChunk, iterationMode),
+              _array(aChunk._array),
+              _chunk(aChunk),
+              _iterators(_array.bindings.size()),
+              _curPos(_array.getArrayDesc().getDimensions().size()),
+              _mode(iterationMode & ~INTENDED_TILE_MODE & ~TILE_MODE),
+              _ignoreEmptyCells((iterationMode & IGNORE_EMPTY_CELLS) == IGNORE_EMPTY_CELLS),
+              _type(_chunk.getAttributeDesc().getType()),
+              _hintForSpatialRanges(0),
+              _sampleState(0),
+              _nextSample(0),
+              _lastSampleCheck(0),
+              _params(*_array.expression),
+              _neighborIterators(_array.bindings.size()),
+              _neighborPos(_array.getArrayDesc().getDimensions().size()),
+              _boundChunks(_array.bindings.size()),
+              _run(0),
+              _skipRuns(false),
+              _probes(0),
+              _termSampleCount(0),
+              _statCounts(),
+              _query(Query::getValidQueryPtr(_array._query))
+    {
+        inputIterator = aChunk.getInputChunk().getConstIterator(iterationMode & ~INTENDED_TILE_MODE);
+        _inputBitmap = aChunk.getInputChunk().getEmptyBitmap();
+
+        // The chunks of the other bound attributes are shared by the iterators of all output attributes.
+        for (size_t i = 0, n = _array.bindings.size(); i < n; i++)
+        {
+            if (_array.bindings[i].kind == BindInfo::BI_ATTRIBUTE &&
+                (AttributeID)_array.bindings[i].resolvedId != arrayIterator._inputAttrID)
+            {
+                _boundChunks[i] = _array.getBoundChunk(i, arrayIterator);
+            }
+        }
+
+        for (size_t i = 0, n = _array.bindings.size(); i < n; i++) {
+            switch (_array.bindings[i].kind) {
+                case BindInfo::BI_COORDINATE:
+                {
+                    //  if iterator is tile mode, then do something
+                    break;
+                }
+                case BindInfo::BI_ATTRIBUTE:
+                {
+                    if (!_array._bindingOffsets[i].empty())
+                    {
+                        // Neighbor bindings are read by position, never advanced with the cell.
+                        ConstChunk const& boundChunk = _boundChunks[i] ? *_boundChunks[i] : aChunk.getInputChunk();
+                        _neighborIterators[i] = boundChunk.getConstIterator(IGNORE_EMPTY_CELLS);
+                    } else if ((AttributeID)_array.bindings[i].resolvedId == arrayIterator._inputAttrID)
+                    {
+                        _iterators[i] = inputIterator;
+                    } else
+                    {
+                        _iterators[i] = _boundChunks[i]->getConstIterator(IGNORE_EMPTY_CELLS);
+                    }
+                    break;
+                }
+                case BindInfo::BI_VALUE:
+                {
+                    _params[i] = _array.bindings[i].value;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        // Every term has its own bindings; the constant ones are set once.
+        for (size_t term = 0, nTerms = _array._terms.size(); term < nTerms; term++)
+        {
+            _termParams.push_back(make_shared<ExpressionContext>(*_array._terms[term]));
+            std::vector<BindInfo> const& bindings = _array._terms[term]->getBindings();
+            for (size_t i = 0, n = bindings.size(); i < n; i++)
+            {
+                if (bindings[i].kind == BindInfo::BI_VALUE)
+                {
+                    (*_termParams[term])[i] = bindings[i].value;
+                }
+            }
+        }
+        if (!_termParams.empty())
+        {
+            _termOrder = _array.getTermOrder();
+            _termSamples.assign(_termParams.size() * 3, 0);
+        }
+
+        if (_array._maskCache && !_chunk._shellDecided)
+        {
+            loadShellMask(arrayIterator);
+        }
+        buildRuns();
+
+        // With a limit, only the first cells of the budget of the chunk are visible.
+        if (_array._limit)
+        {
+            Coordinates const& chunkPos = _chunk.getFirstPosition(false);
+            uint64_t budget = 0;
+            bool known = _array.findChunkBudget(chunkPos, budget);
+            uint64_t count = buildVisibility(budget);
+            if (!known)
+            {
+                uint64_t granted = _array.commitChunkBudget(chunkPos, count);
+                if (granted < count)
+                {
+                    trimVisibility(granted);
+                }
+            }
+        }
+
+        restart();
+        nextVisible();
+    }
+
+    BCBetweenChunkIterator::~BCBetweenChunkIterator()
+    {
+        if (_termSampleCount && !_termOrder)
+        {
+            flushTermSamples();
+        }
+
+        if (_array._stats)
+        {
+            _array._stats->add(_statCounts);
+        }
+
+        // The shell cells are evaluated as the consumer pulls them, interleaved with its own work, so
+        // their evaluation time is no span of its own; it is recorded as a counter.
+        uint64_t nanos = _statCounts[BCBetweenStats::EVALUATE_NANOS];
+        if (_array._trace && nanos)
+        {
+            _array._trace->count("shell evaluation nanoseconds", nanos);
+        }
+    }
+
+    //
+    // Role _chunk iterator methods
+    // The role is a template parameter, so every switch on it is resolved at compile time.
+    //
+    static Value makeBitmapValue(bool set)
+    {
+        Value value(TypeLibrary::getType(TID_BOOL));
+        value.setBool(set);
+        return value;
+    }
+
+    /**
+     * The values of the empty bitmap roles, shared by all their iterators.
+     */
+    static Value const& getBitmapValue(bool set)
+    {
+        static Value const setValue = makeBitmapValue(true);
+        static Value const unsetValue = makeBitmapValue(false);
+        return set ? setValue : unsetValue;
+    }
+
+    template <BCBetweenChunkRole role>
+    Value const& BCBetweenRoleChunkIterator<role>::getItem()
+    {
+        switch (role)
+        {
+            case ROLE_EXISTED_BITMAP:
+                return getBitmapValue(_ignoreEmptyCells || (inputIterator->getItem().getBool() && filter()));
+            case ROLE_NEW_BITMAP:
+                return getBitmapValue(_ignoreEmptyCells || filter());
+            default:
+                return BCBetweenChunkIterator::getItem();
+        }
+    }
+
+    template <BCBetweenChunkRole role>
+    BCBetweenRoleChunkIterator<role>::BCBetweenRoleChunkIterator(BCBetweenArrayIterator const& arrayIterator,
+                                                                 BCBetweenChunk const& chunk, int iterationMode)
+            : BCBetweenChunkIterator(arrayIterator, chunk, iterationMode)
     {
-        _value.setBool(true);
     }
 
+    template class BCBetweenRoleChunkIterator<ROLE_DATA>;
+    template class BCBetweenRoleChunkIterator<ROLE_EXISTED_BITMAP>;
+    template class BCBetweenRoleChunkIterator<ROLE_NEW_BITMAP>;
+
     //
     // BCBetweenArrayEmptyBitmapIterator methods
     //
@@ -411,8 +1165,14 @@ namespace scidb
               _curPos(arr.getArrayDesc().getDimensions().size()),
               _hintForSpatialRanges(0),
               _iterators(arr.bindings.size()),
-              _inputAttrID(inputAttrID)
+              _inputAttrID(inputAttrID),
+              _scanCursor(0),
+              _scanCursorEnded(false)
     {
+        if (_array._sharedScan)
+        {
+            _scanCursor = _array._sharedScan->addCursor(_array._scanReader);
+        }
         _spatialRangesChunkPosIteratorPtr = std::shared_ptr<SpatialRangesChunkPosIterator>(
                 new SpatialRangesChunkPosIterator(_array._spatialRangesPtr, _array.getArrayDesc()));
 
@@ -445,8 +1205,30 @@ namespace scidb
         restart();
     }
 
+    BCBetweenArrayIterator::~BCBetweenArrayIterator()
+    {
+        if (_array._sharedScan)
+        {
+            _array._sharedScan->removeCursor(_array._scanReader, _scanCursor);
+        }
+    }
+
     bool BCBetweenArrayIterator::end()
     {
+        // Past the limit, the chunks are neither read nor filtered.
+        if (_hasCurrent && !_array.isChunkWithinLimit(_curPos))
+        {
+            _hasCurrent = false;
+        }
+
+        // An iterator at its end reaches no shared chunk anymore, until it is moved again.
+        if (!_hasCurrent && _array._sharedScan && !_scanCursorEnded)
+        {
+            _array._sharedScan->moveCursor(_array._scanReader, _scanCursor, Coordinates());
+            _scanCursorEnded = true;
+            _sharedChunk.reset();
+            _sharedChunkPos.clear();
+        }
         return !_hasCurrent;
     }
 
@@ -467,7 +1249,9 @@ namespace scidb
         }
 
         // If the position does not correspond to a _chunk intersecting some query range, fail.
-        if (!_array._extendedSpatialRangesPtr->findOneThatContains(newChunkPos, _hintForSpatialRanges))
+        // A chunk of another instance fails without probing the input.
+        if (!_array.isLocalChunk(newChunkPos) || !_array.isChunkInRange(newChunkPos, _hintForSpatialRanges) ||
+            !_array.isChunkWithinLimit(newChunkPos))
         {
             _hasCurrent = false;
             return false;
@@ -477,6 +1261,11 @@ namespace scidb
         _hasCurrent = true;
         chunkInitialized = false;
         _curPos = newChunkPos;
+        if (_array._complement)
+        {
+            _hasCurrent = setAllIteratorsPosition(_curPos);
+            return _hasCurrent;
+        }
         if (_spatialRangesChunkPosIteratorPtr->end() || _spatialRangesChunkPosIteratorPtr->getPosition() > _curPos)
         {
             _spatialRangesChunkPosIteratorPtr->restart();
@@ -488,9 +1277,39 @@ namespace scidb
         return setAllIteratorsPosition(_curPos);
     }
 
+    ConstChunk const& BCBetweenArrayIterator::getInputChunk()
+    {
+        if (!_array._sharedScan)
+        {
+            return inputIterator->getChunk();
+        }
+
+        // The scan is asked once per position; null when this reader reads the chunk itself.
+        if (_sharedChunkPos != _curPos)
+        {
+            _array._sharedScan->moveCursor(_array._scanReader, _scanCursor, _curPos);
+            _scanCursorEnded = false;
+            bool shared = false;
+            _sharedChunk = _array._sharedScan->getChunk(_array._scanReader, _inputAttrID, _curPos, *inputIterator,
+                                                        _array.getInputArray(), shared);
+            _sharedChunkPos = _curPos;
+            if (shared && _array._stats)
+            {
+                _array._stats->add(BCBetweenStats::CHUNKS_SHARED, 1);
+            }
+        }
+        return _sharedChunk ? *_sharedChunk : inputIterator->getChunk();
+    }
+
     ConstChunk const& BCBetweenArrayIterator::getChunk()
     {
-        chunk->setInputChunk(inputIterator->getChunk());
+        ConstChunk const* inputChunk;
+        {
+            BCBetweenTrace::Span span(_array._trace.get(), "fetch input chunk", _curPos, attr);
+            inputChunk = &getInputChunk();
+        }
+        BCBetweenTrace::Span span(_array._trace.get(), "classify", _curPos, attr);
+        chunk->setInputChunk(*inputChunk);
         chunk->overrideClone(false);
         return *chunk;
     }
@@ -512,6 +1331,23 @@ namespace scidb
         }
     }
 
+    void BCBetweenArrayIterator::advanceToNextChunkOutsideInner()
+    {
+        _hasCurrent = false;
+        chunkInitialized = false;
+
+        while (!inputIterator->end())
+        {
+            _curPos = inputIterator->getPosition();
+            if (_array.isChunkInRange(_curPos, _hintForSpatialRanges))
+            {
+                _hasCurrent = true;
+                return;
+            }
+            moveNext();
+        }
+    }
+
     void BCBetweenArrayIterator::advanceToNextChunkInRange()
     {
         assert(!inputIterator->end() && !_spatialRangesChunkPosIteratorPtr->end());
@@ -529,7 +1365,7 @@ namespace scidb
                 return;
             }
             _curPos = inputIterator->getPosition();
-            if (_array._extendedSpatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges))
+            if (_array.isChunkInRange(_curPos, _hintForSpatialRanges))
             {
                 _hasCurrent = true;
                 _spatialRangesChunkPosIteratorPtr->advancePositionToAtLeast(_curPos);
@@ -564,8 +1400,23 @@ namespace scidb
                     return;
                 }
             }
+
+            // A position held by another instance can never be found in _inputIterator, so it is not probed;
+            // the next round moves both iterators on. Checking one position per round keeps the walk in step
+            // with _inputIterator, which only visits the local chunks, however many of the window's chunk
+            // positions the other instances hold.
+            if (!_array.isLocalChunk(_spatialRangesChunkPosIteratorPtr->getPosition()))
+            {
+                continue;
+            }
             Coordinates const& myPos = _spatialRangesChunkPosIteratorPtr->getPosition();
-            if (inputIterator->setPosition(myPos))
+            bool found = inputIterator->setPosition(myPos);
+            if (_array._stats)
+            {
+                _array._stats->add(BCBetweenStats::PROBES, 1);
+                _array._stats->add(BCBetweenStats::FAILED_PROBES, !found);
+            }
+            if (found)
             {
                 setAllIteratorsPosition(myPos);
                 // The position suggested by _spatialRangesChunkPosIterator exists in _inputIterator.
@@ -587,6 +1438,12 @@ namespace scidb
     void BCBetweenArrayIterator::operator ++()
     {
         assert(!end());
+        if (_array._complement)
+        {
+            moveNext();
+            advanceToNextChunkOutsideInner();
+            return;
+        }
         assert(!inputIterator->end() && _hasCurrent && !_spatialRangesChunkPosIteratorPtr->end());
         assert(_spatialRangesChunkPosIteratorPtr->getPosition() == inputIterator->getPosition());
 
@@ -599,6 +1456,23 @@ namespace scidb
         inputIterator->restart();
         _spatialRangesChunkPosIteratorPtr->restart();
 
+        if (_array._complement)
+        {
+            for (size_t i = 0, n = _iterators.size(); i < n; i++)
+            {
+                if (_iterators[i] && _iterators[i] != inputIterator)
+                {
+                    _iterators[i]->restart();
+                }
+            }
+            if (_emptyBitmapIterator)
+            {
+                _emptyBitmapIterator->restart();
+            }
+            advanceToNextChunkOutsideInner();
+            return;
+        }
+
         // If any of the two _iterators is invalid, fail.
         if (inputIterator->end() || _spatialRangesChunkPosIteratorPtr->end())
         {
@@ -608,7 +1482,7 @@ namespace scidb
 
         // Is _inputIterator pointing to a position intersecting some query range?
         _curPos = inputIterator->getPosition();
-        _hasCurrent = _array._extendedSpatialRangesPtr->findOneThatContains(_curPos, _hintForSpatialRanges);
+        _hasCurrent = _array.isChunkInRange(_curPos, _hintForSpatialRanges);
         if (_hasCurrent)
         {
             assert(_curPos >= _spatialRangesChunkPosIteratorPtr->getPosition());
@@ -687,7 +1561,8 @@ namespace scidb
                                    std::shared_ptr<Array> const& input,
                                    std::shared_ptr<Expression> expr,
                                    std::shared_ptr<Query>& query,
-                                   bool tileMode)
+                                   bool tileMode,
+                                   BCBetweenSettings const& settings)
             : DelegateArray(array, input),
               _spatialRangesPtr(spatialRangesPtr),
               _innerSpatialRnagesPtr(innerSpatialRangesPtr),
@@ -695,21 +1570,762 @@ namespace scidb
               bindings(expr->getBindings()),
               _tileMode(tileMode),
               cacheSize(Config::getInstance()->getOption<int>(CONFIG_RESULT_PREFETCH_QUEUE_SIZE)),
-              emptyAttrID(desc.getEmptyBitmapAttribute()->getId())
+              emptyAttrID(desc.getEmptyBitmapAttribute()->getId()),
+              _sampled(settings.isSampled()),
+              _sampleRate(1.0),
+              _sampleSeed(settings.getSampleSeed()),
+              _complement(settings.isComplement()),
+              _bindingOffsets(bindings.size()),
+              _haloCacheSize(0),
+              _nArrayIterators(0),
+              _nInstances(0),
+              _instanceID(0),
+              _scanReader(0),
+              _zoneMapConvex(false),
+              _limit(settings.getLimit()),
+              _limitLeft(settings.getLimit()),
+              _termsAnd(settings.isTermsAnd())
     {
         assert(query);
         _query = query;
-
-        // Copy _spatialRangesPtr to extendedSpatialRangesPtr, but reducing low by (interval-1) to cover chunkPos.
-        _extendedSpatialRangesPtr = make_shared<SpatialRanges>(_spatialRangesPtr->numDims());
-        auto const& ranges = _spatialRangesPtr->ranges();
-        for (size_t i=0; i < ranges.size(); ++i) {
-            Coordinates newLow = ranges[i]._low;
-            array.getChunkPositionFor(newLow);
-            _extendedSpatialRangesPtr->insert(SpatialRange(newLow, ranges[i]._high));
+        resolvePrepared(settings);
+        std::shared_ptr<BCBetweenPrepared::Scaffold const> scaffold =
+                _prepared ? _prepared->getScaffold() : std::shared_ptr<BCBetweenPrepared::Scaffold const>();
+        resolveNeighbors(settings, query, scaffold.get());
+        resolveLocalDistribution(query);
+        resolveMaskCache(settings);
+        resolveZoneMap(settings);
+        resolveTerms(settings, scaffold.get());
+        if (_prepared && !scaffold)
+        {
+            std::shared_ptr<BCBetweenPrepared::Scaffold> built = make_shared<BCBetweenPrepared::Scaffold>();
+            built->bindingOffsets = _bindingOffsets;
+            built->haloReach = _haloReach;
+            built->termBindings = _termBindings;
+            _prepared->setScaffold(built);
+        }
+        if (settings.isStats())
+        {
+            _stats = make_shared<BCBetweenStats>();
+            std::ostringstream queryID;
+            queryID << query->getQueryID();
+            _queryID = queryID.str();
+        }
+        if (settings.isTraced())
+        {
+            _trace = make_shared<BCBetweenTrace>(settings.getTracePath(), query->getQueryID(), query->getInstanceID());
+        }
+
+        if (_sampled)
+        {
+            double volume = 0;
+            for (SpatialRange const& range : _spatialRangesPtr->ranges())
+            {
+                double cells = 1;
+                for (size_t i = 0, n = range._low.size(); i < n; i++)
+                {
+                    cells *= static_cast<double>(range._high[i] - range._low[i] + 1);
+                }
+                volume += cells;
+            }
+            _sampleRate = settings.getSampleRate(volume);
+            _sampled = _sampleRate < 1.0;
+        }
+
+        // Copy _spatialRangesPtr to extendedSpatialRangesPtr, but reducing low by (interval-1) to cover chunkPos.
+        _extendedSpatialRangesPtr = make_shared<SpatialRanges>(_spatialRangesPtr->numDims());
+        auto const& ranges = _spatialRangesPtr->ranges();
+        for (size_t i=0; i < ranges.size(); ++i) {
+            Coordinates newLow = ranges[i]._low;
+            array.getChunkPositionFor(newLow);
+            _extendedSpatialRangesPtr->insert(SpatialRange(newLow, ranges[i]._high));
+        }
+        _extendedSpatialRangesPtr->buildIndex();
+        resolveSharedScan(settings);
+    }
+
+    BCBetweenArray::~BCBetweenArray()
+    {
+        if (_sharedScan)
+        {
+            _sharedScan->leave(_scanReader);
+        }
+        if (_stats)
+        {
+            _stats->publish(_queryID);
+        }
+    }
+
+    std::shared_ptr<ConstChunk> BCBetweenArray::getBoundChunk(size_t binding, BCBetweenArrayIterator const& arrayIterator) const
+    {
+        AttributeID attrID = safe_static_cast<AttributeID>(bindings[binding].resolvedId);
+        Coordinates const& chunkPos = arrayIterator._curPos;
+        {
+            ScopedMutexLock cs(_boundMutex);
+            BoundChunks::const_iterator it = _boundChunks.find(chunkPos);
+            if (it != _boundChunks.end())
+            {
+                std::map<AttributeID, std::shared_ptr<ConstChunk> >::const_iterator chunk = it->second.find(attrID);
+                if (chunk != it->second.end())
+                {
+                    return chunk->second;
+                }
+            }
+        }
+
+        // With a single output iterator, no other one reads the chunk, so its chunk iterators read it in
+        // place, while the array iterator stays on the position; the pointer does not own the chunk.
+        // The shared scan hands out copies, unless no other reader waits for the chunk.
+        std::shared_ptr<ConstChunk> copy;
+        if (_sharedScan)
+        {
+            bool shared = false;
+            copy = _sharedScan->getChunk(_scanReader, attrID, chunkPos, *arrayIterator._iterators[binding],
+                                         inputArray, shared);
+            if (shared && _stats)
+            {
+                _stats->add(BCBetweenStats::CHUNKS_SHARED, 1);
+            }
+        }
+        if (!copy && _nArrayIterators == 1)
+        {
+            ConstChunk const& src = arrayIterator._iterators[binding]->getChunk();
+            return std::shared_ptr<ConstChunk>(std::shared_ptr<ConstChunk>(), const_cast<ConstChunk*>(&src));
+        }
+
+        // Copy the chunk, so that it outlives the position of the iterator it is read from.
+        if (!copy)
+        {
+            ConstChunk const& src = arrayIterator._iterators[binding]->getChunk();
+            std::shared_ptr<MemChunk> memChunk = make_shared<MemChunk>();
+            {
+                PinBuffer scope(src);
+                memChunk->initialize(src);
+                memChunk->allocate(src.getSize());
+                memcpy(memChunk->getData(), src.getData(), src.getSize());
+            }
+            copy = memChunk;
+        }
+
+        // Another iterator may have copied it meanwhile; keep the first copy. The chunks of a position
+        // are dropped together, with the oldest position.
+        ScopedMutexLock cs(_boundMutex);
+        std::pair<BoundChunks::iterator, bool> position =
+                _boundChunks.insert(std::make_pair(chunkPos, std::map<AttributeID, std::shared_ptr<ConstChunk> >()));
+        std::shared_ptr<ConstChunk> result = position.first->second.insert(std::make_pair(attrID, copy)).first->second;
+        if (position.second)
+        {
+            _boundOrder.push_back(chunkPos);
+            while (_boundOrder.size() > std::max<size_t>(cacheSize, 1))
+            {
+                _boundChunks.erase(_boundOrder.front());
+                _boundOrder.pop_front();
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<MemChunk> BCBetweenArray::getFullBitmapChunk(ConstChunk const& inputChunk) const
+    {
+        Coordinates const& first = inputChunk.getFirstPosition(true);
+        Coordinates const& last = inputChunk.getLastPosition(true);
+        uint64_t nCells = 1;
+        for (size_t i = 0, n = first.size(); i < n; i++)
+        {
+            nCells *= last[i] - first[i] + 1;
+        }
+
+        std::shared_ptr<std::vector<char> const> packed;
+        {
+            ScopedMutexLock cs(_fullBitmapMutex);
+            std::shared_ptr<std::vector<char> const>& shared = _fullBitmaps[nCells];
+            if (!shared)
+            {
+                RLEEmptyBitmap bitmap;
+                ConstRLEEmptyBitmap::Segment segment;
+                segment._lPosition = 0;
+                segment._length = nCells;
+                segment._pPosition = 0;
+                bitmap.addSegment(segment);
+                std::shared_ptr<std::vector<char> > buffer = make_shared<std::vector<char> >(bitmap.packedSize());
+                bitmap.pack(&(*buffer)[0]);
+                shared = buffer;
+            }
+            packed = shared;
+        }
+
+        AttributeDesc const& emptyAttr = *desc.getEmptyBitmapAttribute();
+        std::shared_ptr<MemChunk> chunk = make_shared<MemChunk>();
+        Address address(emptyAttrID, inputChunk.getFirstPosition(false));
+        chunk->initialize(this, &desc, address, emptyAttr.getDefaultCompressionMethod());
+        chunk->allocate(packed->size());
+        memcpy(chunk->getData(), &(*packed)[0], packed->size());
+        return chunk;
+    }
+
+    void BCBetweenArray::resolveLocalDistribution(std::shared_ptr<Query> const& query)
+    {
+        ArrayDesc const& inputDesc = inputArray->getArrayDesc();
+        ArrayDistPtr distribution = inputDesc.getDistribution();
+        ArrayResPtr residency = inputDesc.getResidency();
+        if (!distribution || !residency || residency->size() != query->getInstancesCount() ||
+            distribution->getRedundancy() != 0)
+        {
+            return;
+        }
+
+        // The distribution maps a chunk to an index into the residency, which is the logical id of
+        // the instance only when the input lives on the instances of the query, in the same order.
+        ArrayResPtr queryResidency = query->getDefaultArrayResidency();
+        if (!queryResidency || queryResidency->size() != residency->size())
+        {
+            return;
+        }
+        for (size_t i = 0, n = residency->size(); i < n; i++)
+        {
+            if (residency->getPhysicalInstanceAt(i) != queryResidency->getPhysicalInstanceAt(i))
+            {
+                return;
+            }
+        }
+
+        PartitioningSchema ps = distribution->getPartitioningSchema();
+        if (ps == psHashPartitioned || ps == psByRow || ps == psByCol)
+        {
+            _localDistribution = distribution;
+            _nInstances = query->getInstancesCount();
+            _instanceID = query->getInstanceID();
+        }
+    }
+
+    void BCBetweenArray::resolveMaskCache(BCBetweenSettings const& settings)
+    {
+        // The masks are kept across the versions of a stored array. Each one is checked against the
+        // digest of its input chunks, except with neighbor bindings, which also read the chunks around;
+        // their masks are kept per version.
+        ArrayDesc const& inputDesc = inputArray->getArrayDesc();
+        if (!settings.isMaskCached() || inputDesc.getUAId() == 0 || inputDesc.getVersionId() == 0 ||
+            inputDesc.isTransient())
+        {
+            return;
+        }
+
+        std::ostringstream key;
+        key << inputDesc.getUAId();
+        if (!settings.getNeighbors().empty())
+        {
+            key << "@" << inputDesc.getVersionId();
+        }
+        for (SpatialRange const& range : _spatialRangesPtr->ranges())
+        {
+            key << " " << coordinateToString(range._low) << coordinateToString(range._high);
+        }
+        key << " inner";
+        for (SpatialRange const& range : _innerSpatialRnagesPtr->ranges())
+        {
+            key << " " << coordinateToString(range._low) << coordinateToString(range._high);
+        }
+        for (size_t i = 0, n = settings.getNeighbors().size(); i < n; i++)
+        {
+            key << " " << settings.getNeighbors()[i].first << ":" << coordinateToString(settings.getNeighbors()[i].second);
+        }
+        key << " ";
+        expression->toString(key);
+
+        _maskCache = make_shared<BCBetweenMaskCache>(settings.getCacheDir(), key.str());
+    }
+
+    void BCBetweenArray::resolvePrepared(BCBetweenSettings const& settings)
+    {
+        // The shape outlives the query, so it is only kept for a stored array version.
+        ArrayDesc const& inputDesc = inputArray->getArrayDesc();
+        if (!settings.isPrepared() || inputDesc.getUAId() == 0 || inputDesc.getVersionId() == 0 ||
+            inputDesc.isTransient())
+        {
+            return;
+        }
+
+        std::ostringstream key;
+        // The zone map of a shape is stored in its cache directory, so the directory is part of the shape.
+        // The neighbor bindings and the terms decide the scaffold and the halos, so they are part of it too.
+        key << inputDesc.getUAId() << "@" << inputDesc.getVersionId() << " " << settings.getCacheDir() << " ";
+        if (!settings.getTerms().empty())
+        {
+            key << (settings.isTermsAnd() ? "and " : "or ");
+        }
+        for (size_t i = 0, n = settings.getNeighbors().size(); i < n; i++)
+        {
+            key << settings.getNeighbors()[i].first << ":" << coordinateToString(settings.getNeighbors()[i].second) << " ";
+        }
+        expression->toString(key);
+        _prepared = BCBetweenPrepared::get(key.str());
+    }
+
+    void BCBetweenArray::resolveSharedScan(BCBetweenSettings const& settings)
+    {
+        // Only the chunks of a stored array version are the same for every query.
+        ArrayDesc const& inputDesc = inputArray->getArrayDesc();
+        if (!settings.isSharedScan() || inputDesc.getUAId() == 0 || inputDesc.getVersionId() == 0 ||
+            inputDesc.isTransient())
+        {
+            return;
+        }
+
+        std::ostringstream key;
+        key << inputDesc.getUAId() << "@" << inputDesc.getVersionId();
+        _sharedScan = BCBetweenSharedScan::get(key.str());
+        _scanReader = _sharedScan->join(_extendedSpatialRangesPtr);
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind == BindInfo::BI_ATTRIBUTE)
+            {
+                _sharedScan->addAttribute(_scanReader, safe_static_cast<AttributeID>(bindings[i].resolvedId));
+            }
+        }
+    }
+
+    void BCBetweenArray::resolveZoneMap(BCBetweenSettings const& settings)
+    {
+        // A coordinate or neighbor binding varies within the chunk whatever its attributes hold.
+        if (!settings.hasZoneMap() || !settings.getNeighbors().empty())
+        {
+            return;
+        }
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind == BindInfo::BI_COORDINATE)
+            {
+                return;
+            }
+        }
+
+        // The synopses are only stored for a stored array version.
+        ArrayDesc const& inputDesc = inputArray->getArrayDesc();
+        bool stored = settings.isMaskCached() && inputDesc.getUAId() != 0 && inputDesc.getVersionId() != 0 &&
+                      !inputDesc.isTransient();
+        std::ostringstream key;
+        key << inputDesc.getUAId() << "@" << inputDesc.getVersionId();
+        _zoneMap = _prepared ? _prepared->getZoneMap() : std::shared_ptr<BCBetweenZoneMap>();
+        if (!_zoneMap)
+        {
+            _zoneMap = make_shared<BCBetweenZoneMap>(stored ? settings.getCacheDir() : std::string(), key.str());
+            if (_prepared)
+            {
+                _prepared->setZoneMap(_zoneMap);
+            }
+        }
+        _zoneMapConvex = settings.getZoneMapMode() == BCBetweenSettings::ZONE_MAP_CONVEX;
+    }
+
+    bool BCBetweenArray::decideShell(BCBetweenArrayIterator const& arrayIterator, ConstChunk const& inputChunk,
+                                     bool& passes) const
+    {
+        std::vector<std::shared_ptr<BCBetweenSynopsis const> > synopses(bindings.size());
+        size_t nRanged = 0;
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind != BindInfo::BI_ATTRIBUTE)
+            {
+                continue;
+            }
+
+            AttributeID attrID = safe_static_cast<AttributeID>(bindings[i].resolvedId);
+            synopses[i] = _zoneMap->get(attrID, arrayIterator._curPos,
+                                        attrID == arrayIterator._inputAttrID
+                                        ? inputChunk
+                                        : *getBoundChunk(i, arrayIterator));
+
+            // How the expression treats nulls is unknown, so a chunk with nulls is never decided.
+            BCBetweenSynopsis const& synopsis = *synopses[i];
+            if (!synopsis.hasCells || synopsis.hasNulls)
+            {
+                return false;
+            }
+            if (!synopsis.constant)
+            {
+                if (!_zoneMapConvex || !synopsis.ordered)
+                {
+                    return false;
+                }
+                nRanged++;
+            }
+        }
+        if (nRanged > MAX_ZONE_MAP_RANGED)
+        {
+            return false;
+        }
+
+        // Evaluate at every corner of the min/max box; with constant attributes only, the box is one cell.
+        ExpressionContext params(*expression);
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind == BindInfo::BI_VALUE)
+            {
+                params[i] = bindings[i].value;
+            }
+        }
+        bool allPass = true;
+        bool allFail = true;
+        for (size_t corner = 0; corner < (size_t(1) << nRanged); corner++)
+        {
+            size_t bit = 0;
+            for (size_t i = 0, n = synopses.size(); i < n; i++)
+            {
+                if (synopses[i])
+                {
+                    BCBetweenSynopsis const& synopsis = *synopses[i];
+                    params[i] = synopsis.constant || !((corner >> bit++) & 1) ? synopsis.min : synopsis.max;
+                }
+            }
+            Value const& result = expression->evaluate(params);
+            bool passed = !result.isNull() && result.getBool();
+            allPass = allPass && passed;
+            allFail = allFail && !passed;
+        }
+
+        // With a convex passing set, the box passes when all its corners do; failing corners prove nothing.
+        if (allPass || (nRanged == 0 && allFail))
+        {
+            passes = allPass;
+            return true;
+        }
+        return false;
+    }
+
+    void BCBetweenArray::resolveTerms(BCBetweenSettings const& settings, BCBetweenPrepared::Scaffold const* scaffold)
+    {
+        // Neighbor bindings are read around the cell, which the terms do not know of.
+        std::vector<std::shared_ptr<Expression> > const& terms = settings.getTerms();
+        if (terms.size() < 2 || !settings.getNeighbors().empty())
+        {
+            return;
+        }
+
+        // Every attribute a term reads is read by the whole expression, through the same iterator.
+        // A prepared shape has resolved them already; empty if some term reads another attribute.
+        std::vector<std::vector<ssize_t> > termBindings(terms.size());
+        if (scaffold)
+        {
+            if (scaffold->termBindings.empty())
+            {
+                return;
+            }
+            termBindings = scaffold->termBindings;
+        }
+        for (size_t term = 0, nTerms = terms.size(); !scaffold && term < nTerms; term++)
+        {
+            std::vector<BindInfo> const& termBinding = terms[term]->getBindings();
+            termBindings[term].assign(termBinding.size(), -1);
+            for (size_t i = 0, n = termBinding.size(); i < n; i++)
+            {
+                if (termBinding[i].kind != BindInfo::BI_ATTRIBUTE)
+                {
+                    continue;
+                }
+                for (size_t j = 0, m = bindings.size(); j < m && termBindings[term][i] < 0; j++)
+                {
+                    if (bindings[j].kind == BindInfo::BI_ATTRIBUTE && bindings[j].resolvedId == termBinding[i].resolvedId)
+                    {
+                        termBindings[term][i] = safe_static_cast<ssize_t>(j);
+                    }
+                }
+                if (termBindings[term][i] < 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        _terms = terms;
+        _termBindings.swap(termBindings);
+        _termSamples.assign(terms.size() * 3, 0);
+        if (_prepared)
+        {
+            _termOrder = _prepared->getTermOrder();
+        }
+    }
+
+    std::shared_ptr<std::vector<size_t> const> BCBetweenArray::getTermOrder() const
+    {
+        ScopedMutexLock cs(_termMutex);
+        return _termOrder;
+    }
+
+    std::shared_ptr<std::vector<size_t> const> BCBetweenArray::addTermSamples(std::vector<uint64_t> const& samples) const
+    {
+        ScopedMutexLock cs(_termMutex);
+        if (_termOrder)
+        {
+            return _termOrder;
+        }
+        for (size_t i = 0, n = samples.size(); i < n; i++)
+        {
+            _termSamples[i] += samples[i];
+        }
+        if (_termSamples[0] < TERM_SAMPLES)
+        {
+            return _termOrder;
+        }
+
+        // Cheapest per decision first: the cost of a term over the rate at which it decides the chain.
+        size_t nTerms = _terms.size();
+        std::vector<double> rank(nTerms);
+        for (size_t term = 0; term < nTerms; term++)
+        {
+            double evaluated = static_cast<double>(_termSamples[term * 3]);
+            double passRate = _termSamples[term * 3 + 1] / evaluated;
+            double cost = _termSamples[term * 3 + 2] / evaluated;
+            rank[term] = cost / std::max(_termsAnd ? 1 - passRate : passRate, 1e-6);
+        }
+        std::shared_ptr<std::vector<size_t> > order = make_shared<std::vector<size_t> >(nTerms);
+        for (size_t term = 0; term < nTerms; term++)
+        {
+            (*order)[term] = term;
+        }
+        std::stable_sort(order->begin(), order->end(),
+                         [&rank](size_t a, size_t b) { return rank[a] < rank[b]; });
+        _termOrder = order;
+        if (_prepared)
+        {
+            _prepared->setTermOrder(_termOrder);
+        }
+        return _termOrder;
+    }
+
+    bool BCBetweenArray::findChunkBudget(Coordinates const& chunkPos, uint64_t& budget) const
+    {
+        ScopedMutexLock cs(_limitMutex);
+        std::map<Coordinates, uint64_t, CoordinatesLess>::const_iterator it = _chunkBudgets.find(chunkPos);
+        if (it != _chunkBudgets.end())
+        {
+            budget = it->second;
+            return true;
+        }
+        budget = _limitLeft;
+        return false;
+    }
+
+    uint64_t BCBetweenArray::commitChunkBudget(Coordinates const& chunkPos, uint64_t count) const
+    {
+        ScopedMutexLock cs(_limitMutex);
+        std::pair<std::map<Coordinates, uint64_t, CoordinatesLess>::iterator, bool> inserted =
+                _chunkBudgets.insert(std::make_pair(chunkPos, std::min(count, _limitLeft)));
+        if (inserted.second)
+        {
+            _limitLeft -= inserted.first->second;
+        }
+        return inserted.first->second;
+    }
+
+    bool BCBetweenArray::isChunkWithinLimit(Coordinates const& chunkPos) const
+    {
+        if (!_limit)
+        {
+            return true;
+        }
+        ScopedMutexLock cs(_limitMutex);
+        return _limitLeft > 0 || _chunkBudgets.find(chunkPos) != _chunkBudgets.end();
+    }
+
+    bool BCBetweenArray::isLocalChunk(Coordinates const& chunkPos) const
+    {
+        if (!_localDistribution)
+        {
+            return true;
+        }
+        return _localDistribution->getPrimaryChunkLocation(
+                chunkPos, inputArray->getArrayDesc().getDimensions(), _nInstances) == _instanceID;
+    }
+
+    void BCBetweenArray::resolveNeighbors(BCBetweenSettings const& settings, std::shared_ptr<Query> const& query,
+                                          BCBetweenPrepared::Scaffold const* scaffold)
+    {
+        std::vector<std::pair<std::string, Coordinates> > const& neighbors = settings.getNeighbors();
+        if (neighbors.empty())
+        {
+            return;
         }
-        _extendedSpatialRangesPtr->buildIndex();
-    }
+
+        // The halos are read from the local chunks only; a neighbor held by another instance would read as null.
+        ArrayDistPtr distribution = inputArray->getArrayDesc().getDistribution();
+        if (query->getInstancesCount() > 1 &&
+            (!distribution || (distribution->getPartitioningSchema() != psReplication &&
+                               distribution->getPartitioningSchema() != psLocalInstance)))
+        {
+            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                    << "bc_between: 'neighbor' needs a replicated input when the query runs on several instances";
+        }
+
+        // A prepared shape has resolved the same neighbors already.
+        Attributes const& inputAttrs = inputArray->getArrayDesc().getAttributes();
+        Dimensions const& dims = desc.getDimensions();
+        size_t nDims = dims.size();
+        _haloReach.assign(nDims, 0);
+        if (scaffold)
+        {
+            _bindingOffsets = scaffold->bindingOffsets;
+            _haloReach = scaffold->haloReach;
+        }
+        for (size_t j = 0, m = neighbors.size(); !scaffold && j < m; j++)
+        {
+            bool bound = false;
+            for (size_t i = 0, n = bindings.size(); i < n; i++)
+            {
+                if (bindings[i].kind == BindInfo::BI_ATTRIBUTE &&
+                    inputAttrs[bindings[i].resolvedId].getName() == neighbors[j].first)
+                {
+                    _bindingOffsets[i] = neighbors[j].second;
+                    bound = true;
+                }
+            }
+            if (!bound)
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'neighbor' attribute '" + neighbors[j].first + "' is not used by the boundary expression";
+            }
+            for (size_t d = 0; d < nDims; d++)
+            {
+                _haloReach[d] = std::max(_haloReach[d], std::abs(neighbors[j].second[d]));
+            }
+        }
+
+        // Chunks are visited in row-major order, so the slabs that can still be needed
+        // span about two hyperplanes of chunks of the window, per neighbor attribute.
+        size_t hyperplane = 1;
+        size_t neighborhood = 1;
+        if (!_spatialRangesPtr->ranges().empty())
+        {
+            SpatialRange const& window = _spatialRangesPtr->ranges()[0];
+            for (size_t d = 1; d < nDims; d++)
+            {
+                int64_t interval = dims[d].getChunkInterval();
+                hyperplane *= (window._high[d] - window._low[d] + _haloReach[d] * 2) / interval + 2;
+            }
+        }
+        for (size_t d = 0; d < nDims; d++)
+        {
+            neighborhood *= 3;
+        }
+        _haloCacheSize = (hyperplane * 2 + neighborhood) * neighbors.size();
+    }
+
+    void BCBetweenArray::getHaloValue(size_t binding, Coordinates const& pos, Value& result) const
+    {
+        Dimensions const& dims = desc.getDimensions();
+        for (size_t d = 0, n = dims.size(); d < n; d++)
+        {
+            if (pos[d] < dims[d].getStartMin() || pos[d] > dims[d].getEndMax())
+            {
+                result.setNull();
+                return;
+            }
+        }
+
+        AttributeID attrID = safe_static_cast<AttributeID>(bindings[binding].resolvedId);
+        Coordinates chunkPos = pos;
+        desc.getChunkPositionFor(chunkPos);
+        Coordinates key = chunkPos;
+        key.push_back(attrID);
+
+        std::shared_ptr<BCBetweenHalo const> halo;
+        {
+            ScopedMutexLock cs(_haloMutex);
+            std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess>::const_iterator it = _haloCache.find(key);
+            if (it != _haloCache.end())
+            {
+                halo = it->second;
+            }
+        }
+        if (!halo)
+        {
+            // A prepared shape keeps the halos of the earlier queries. Otherwise, load outside the lock,
+            // so that the threads reading other halos do not wait for this one.
+            halo = _prepared ? _prepared->getHalo(key) : std::shared_ptr<BCBetweenHalo const>();
+            if (!halo)
+            {
+                halo = loadHalo(attrID, chunkPos);
+                if (_prepared)
+                {
+                    _prepared->addHalo(key, halo);
+                }
+            }
+
+            ScopedMutexLock cs(_haloMutex);
+            std::pair<std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess>::iterator, bool> inserted =
+                    _haloCache.insert(std::make_pair(key, halo));
+            halo = inserted.first->second;
+            if (inserted.second && _haloCache.size() > _haloCacheSize)
+            {
+                // Keys are chunk positions, and chunks are visited in order: the first one is the oldest.
+                _haloCache.erase(_haloCache.begin());
+            }
+        }
+
+        position_t position = halo->getPosition(pos);
+        std::vector<position_t>::const_iterator cell =
+                std::lower_bound(halo->positions.begin(), halo->positions.end(), position);
+        if (cell == halo->positions.end() || *cell != position)
+        {
+            result.setNull();
+        } else
+        {
+            result = halo->values[cell - halo->positions.begin()];
+        }
+    }
+
+    std::shared_ptr<BCBetweenHalo const> BCBetweenArray::loadHalo(AttributeID attrID, Coordinates const& chunkPos) const
+    {
+        Dimensions const& dims = desc.getDimensions();
+        size_t nDims = dims.size();
+        std::shared_ptr<BCBetweenHalo> halo = make_shared<BCBetweenHalo>();
+        halo->first = chunkPos;
+        halo->last.resize(nDims);
+        for (size_t d = 0; d < nDims; d++)
+        {
+            halo->last[d] = std::min(chunkPos[d] + dims[d].getChunkInterval() - 1, dims[d].getEndMax());
+        }
+
+        // An iterator of its own, since several threads may load halos at once.
+        std::shared_ptr<ConstArrayIterator> arrayIterator = inputArray->getConstIterator(attrID);
+        if (!arrayIterator->setPosition(chunkPos))
+        {
+            return halo;
+        }
+
+        // The chunk iterator goes in row-major order, so the positions come sorted.
+        std::shared_ptr<ConstChunkIterator> it = arrayIterator->getChunk().getConstIterator(
+                ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+        for (; !it->end(); ++(*it))
+        {
+            Coordinates const& pos = it->getPosition();
+            for (size_t d = 0; d < nDims; d++)
+            {
+                if (pos[d] - halo->first[d] < _haloReach[d] || halo->last[d] - pos[d] < _haloReach[d])
+                {
+                    halo->positions.push_back(halo->getPosition(pos));
+                    halo->values.push_back(it->getItem());
+                    break;
+                }
+            }
+        }
+        return halo;
+    }
+
+    bool BCBetweenArray::isChunkInRange(Coordinates const& chunkPos, size_t& hint) const
+    {
+        if (!_complement)
+        {
+            return _extendedSpatialRangesPtr->findOneThatContains(chunkPos, hint);
+        }
+
+        Dimensions const& dims = desc.getDimensions();
+        SpatialRange chunkRange(chunkPos, chunkPos);
+        for (size_t i = 0, n = dims.size(); i < n; i++)
+        {
+            chunkRange._high[i] = std::min(chunkPos[i] + dims[i].getChunkInterval() - 1, dims[i].getEndMax());
+        }
+        return !_innerSpatialRnagesPtr->findOneThatContains(chunkRange, hint);
+    }
 
     DelegateArrayIterator* BCBetweenArray::createArrayIterator(AttributeID attrID) const
     {
@@ -727,6 +2343,11 @@ namespace scidb
             }
         }
 
+        if (_sharedScan)
+        {
+            _sharedScan->addAttribute(_scanReader, inputAttrID);
+        }
+        _nArrayIterators++;
         return new BCBetweenArrayIterator(*this, attrID, inputAttrID);
     }
 
@@ -742,14 +2363,21 @@ namespace scidb
         {
             ScopedMutexLock cs(mutex);
             chunk = cache[pos];
+            if (_stats)
+            {
+                _stats->add(chunk ? BCBetweenStats::BITMAP_CACHE_HITS : BCBetweenStats::BITMAP_CACHE_MISSES, 1);
+            }
             if (chunk)
             {
                 return chunk;
             }
         }
-        chunk = std::shared_ptr<DelegateChunk>(createChunk(iterator, emptyAttrID));
-        chunk->setInputChunk(iterator->getInputIterator()->getChunk());
-        chunk->materialize();
+        {
+            BCBetweenTrace::Span span(_trace.get(), "materialize empty bitmap", pos, emptyAttrID);
+            chunk = std::shared_ptr<DelegateChunk>(createChunk(iterator, emptyAttrID));
+            chunk->setInputChunk(iterator->getInputChunk());
+            chunk->materialize();
+        }
         {
             ScopedMutexLock cs(mutex);
             if (cache.size() >= cacheSize)
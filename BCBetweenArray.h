@@ -41,10 +41,22 @@
 
 #include <string>
 #include <array/DelegateArray.h>
+#include <array/MemArray.h>
 #include <array/Metadata.h>
 #include <array/SpatialRangesChunkPosIterator.h>
 #include <query/Operator.h>
 #include <vector>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <map>
+#include "BCBetweenMaskCache.h"
+#include "BCBetweenPrepared.h"
+#include "BCBetweenSettings.h"
+#include "BCBetweenSharedScan.h"
+#include "BCBetweenStats.h"
+#include "BCBetweenTrace.h"
+#include "BCBetweenZoneMap.h"
 
 namespace scidb
 {
@@ -55,11 +67,49 @@ namespace scidb
     class BCBetweenArrayIterator;
     class BCBetweenChunkIterator;
 
+    /**
+     * The role of a chunk iterator of a chunk that is not passed through:
+     * ROLE_DATA, an attribute, filtered cell by cell;
+     * ROLE_EXISTED_BITMAP, the empty bitmap of an input that has one, and-ed with the filter;
+     * ROLE_NEW_BITMAP, the empty bitmap of an input that has none, which is the filter.
+     * The empty bitmap of an input that has none, for a fully inside chunk, is a prebuilt full bitmap chunk.
+     */
+    enum BCBetweenChunkRole
+    {
+        ROLE_DATA,
+        ROLE_EXISTED_BITMAP,
+        ROLE_NEW_BITMAP
+    };
+
     typedef std::shared_ptr<SpatialRanges> SpatialRangesPtr;
     typedef std::shared_ptr<SpatialRangesChunkPosIterator> SpatialRangesChunkPosIteratorPtr;
 
     std::string coordinateToString(Coordinates const& coor);
 
+    /**
+     * The edge slab of one input chunk: its cells within the halo reach of the chunk faces.
+     * Serves the neighbor bindings that cross a chunk border.
+     * The cells are kept by their row-major linear position within the chunk, without overlap, in
+     * ascending order, and looked up by binary search.
+     */
+    struct BCBetweenHalo
+    {
+        Coordinates first;
+        Coordinates last;
+        std::vector<position_t> positions;
+        std::vector<Value> values;
+
+        position_t getPosition(Coordinates const& pos) const
+        {
+            position_t result = 0;
+            for (size_t d = 0, n = pos.size(); d < n; d++)
+            {
+                result = result * (last[d] - first[d] + 1) + (pos[d] - first[d]);
+            }
+            return result;
+        }
+    };
+
     class BCBetweenChunk : public DelegateChunk
     {
         friend class BCBetweenChunkIterator;
@@ -68,14 +118,41 @@ namespace scidb
         // It needs _fullyInside member variable but, BCBetweenArray cannot know.
          virtual std::shared_ptr<ConstChunkIterator> getConstIterator(int iterationMode) const;
         virtual void setInputChunk(ConstChunk const& inputChunk);
+        virtual ConstChunk* materialize() const;
 
         BCBetweenChunk(BCBetweenArray const& array, DelegateArrayIterator const& iterator, AttributeID attrID);
 
+        /**
+         * Whether every cell of the input chunk is selected.
+         */
+        bool isFullyInside() const
+        {
+            return _fullyInside;
+        }
+
     private:
         BCBetweenArray const& _array;
         SpatialRange _myRange;  // the firstPosition and lastPosition of this _chunk.
+
+        /**
+         * _fullyInside: every cell of the chunk is selected, so the chunk is passed through.
+         * _fullyOutside: no cell of the chunk is selected.
+         * In complement mode, these are the chunks fully outside the window and fully inside the inner window.
+         */
         bool _fullyInside;
         bool _fullyOutside;
+
+        /**
+         * _shellDecided: the zone map proves the boundary expression has the result _shellPasses on every cell.
+         */
+        bool _shellDecided;
+        bool _shellPasses;
+
+        /**
+         * For a fully inside chunk of a new empty tag; every cell of the input is present, so the bitmap
+         * is a single run, built without reading the input.
+         */
+        std::shared_ptr<MemChunk> _fullBitmap;
         std::shared_ptr<ConstArrayIterator> _emptyBitmapIterator;
     };
 
@@ -83,11 +160,97 @@ namespace scidb
     {
     protected:
         Value& evaluate();
-        bool filter();
+        bool passes();
+        bool timedPasses();
+
+        /**
+         * Reordering.
+         * While the array has no order of the terms yet, every term is evaluated and measured, and the
+         * samples are handed to the array every TERM_SAMPLE_BATCH cells. Then the terms are evaluated
+         * in that order, up to the first one that decides the chain.
+         */
+        bool evaluateTerm(size_t term);
+        bool evaluateTerms();
+        void flushTermSamples();
+        void readNeighbor(size_t binding);
+
+        /**
+         * Whether the current cell is visible. Counted once per cell the consumer moves over, by
+         * nextVisible() and setPosition(); the bitmap roles, the visibility and the limit passes re-filter
+         * cells without counting them.
+         */
+        bool filter(bool counted = false);
         void moveNext();
         void advancedMoveNext();
         void nextVisible();
 
+        /**
+         * Sampling.
+         * The sampled cells of every row segment, the cells of a row along the last dimension within one
+         * chunk interval, are drawn with geometric skips from the start of the segment. The generator is
+         * seeded from the sample seed and the row segment, so a cell has the same draw in every attribute,
+         * on every run, and in the overlap of every chunk that holds it.
+         * advanceSampler() returns the first sampled coordinate along the last dimension at or after pos,
+         * in the row segment of pos; nextVisible() jumps the input there instead of stepping through the
+         * cells in between.
+         */
+        Coordinate advanceSampler(Coordinates const& pos) const;
+        bool isSampled() const;
+        position_t drawSkip() const;
+
+        /**
+         * Get the shell mask of the chunk from the mask cache, or compute it by evaluating the boundary
+         * expression on every shell cell of the chunk, and store it.
+         */
+        void loadShellMask(BCBetweenArrayIterator const& arrayIterator);
+
+        /**
+         * The digest of what the shell mask depends on: the identity of the stored chunks of the input
+         * attribute and of every bound attribute, as read by arrayIterator, without reading their payload.
+         */
+        std::string getInputDigest(BCBetweenArrayIterator const& arrayIterator) const;
+        void addChunkIdentity(BCBetweenMaskCache::Hasher& hasher, ConstChunk const& chunk) const;
+
+        /**
+         * Run skipping.
+         * _runs are the runs of linear positions of the chunk that are both non-empty and on a row of
+         * the window (in complement mode, off the rows of the inner window), computed from the empty
+         * bitmap of the input chunk without reading any value. nextVisible() jumps from the end of a run
+         * to the start of the next one instead of stepping through the cells in between.
+         */
+        void buildRuns();
+        void addRows(SpatialRanges const& ranges, std::vector<std::pair<position_t, position_t> >& rows) const;
+        bool skipToRun();
+
+        /**
+         * Move pos to the first linear position at or after it that is non-empty and within the box the
+         * input iterator covers, that is without the overlaps under IGNORE_OVERLAPS. False if there is none.
+         */
+        bool findInputPosition(position_t& pos) const;
+
+        /**
+         * Move all the iterators to the first cell at or after pos that the input iterator visits.
+         * False if there is none.
+         */
+        bool jumpTo(position_t pos);
+
+        /**
+         * Record the result of filter() on the cells of the chunk in _visibility, in one pass that
+         * stops after limit passing cells. Returns the number of passing cells recorded.
+         *
+         * Random access: after VISIBILITY_PROBES calls to setPosition(), the pass runs over the whole chunk.
+         * From then on, filter() is a bit test and the iterators of the bindings are no longer moved,
+         * so that a probe costs one setPosition() on the input.
+         *
+         * Limit: the pass runs up front, and stops as soon as the budget of the chunk is found.
+         */
+        uint64_t buildVisibility(uint64_t limit = std::numeric_limits<uint64_t>::max());
+
+        /**
+         * Keep the first budget cells of _visibility.
+         */
+        void trimVisibility(uint64_t budget);
+
     public:
         int getMode() const {
             return _mode;
@@ -104,11 +267,12 @@ namespace scidb
 
         std::shared_ptr<Query> getQuery() { return _query; }
 
-        BCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator,
-                               BCBetweenChunk const& chunk, int iterationMode);
+        virtual ~BCBetweenChunkIterator();
 
     protected:
-
+        // Only constructed through BCBetweenRoleChunkIterator.
+        BCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator,
+                               BCBetweenChunk const& chunk, int iterationMode);
 
     protected:
         BCBetweenArray const& _array;
@@ -126,47 +290,75 @@ namespace scidb
          */
         mutable size_t _hintForSpatialRanges;
 
+        /**
+         * Sampler state: the row segment, as the position of its first cell, the generator, the next
+         * sampled coordinate along the last dimension, and the last one asked for.
+         */
+        mutable Coordinates _sampleRow;
+        mutable uint64_t _sampleState;
+        mutable Coordinate _nextSample;
+        mutable Coordinate _lastSampleCheck;
+
         // For filter boundary
         ExpressionContext _params;
         std::vector<std::shared_ptr<ConstChunkIterator>> _iterators;
         Value _tileValue;
 
-    private:
-        std::shared_ptr<Query> _query;
-    };
+        // The shared copies of the chunks of the bound attributes other than this one.
+        std::vector<std::shared_ptr<ConstChunk>> _boundChunks;
 
-    class ExistedBitmapBCBetweenChunkIterator : public BCBetweenChunkIterator
-    {
-    public:
-        virtual Value const& getItem();
+        // For neighbor bindings; random access iterators over the bound chunks.
+        std::vector<std::shared_ptr<ConstChunkIterator>> _neighborIterators;
+        Coordinates _neighborPos;
 
-        ExistedBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode);
+        // For run skipping; the empty bitmap of the input chunk, [start, end) linear positions, and the run
+        // at or after the current cell.
+        std::shared_ptr<ConstRLEEmptyBitmap> _inputBitmap;
+        std::vector<std::pair<position_t, position_t> > _runs;
+        size_t _run;
+        bool _skipRuns;
 
-    private:
-        Value _value;
-    };
+        // For reordering; the bindings of every term, the order once measured, and the samples so far:
+        // evaluated, passed and nanoseconds per term.
+        std::vector<std::shared_ptr<ExpressionContext> > _termParams;
+        std::shared_ptr<std::vector<size_t> const> _termOrder;
+        std::vector<uint64_t> _termSamples;
+        size_t _termSampleCount;
 
+        // For random access; the cells that pass filter(), once built, and the number of probes so far.
+        std::shared_ptr<BCBetweenMask> _visibility;
+        size_t _probes;
+        static const size_t VISIBILITY_PROBES = 4;
 
-    class NewBitmapBCBetweenChunkIterator : public BCBetweenChunkIterator
-    {
-    public:
-        virtual Value const& getItem();
+        // For the mask cache; the results of the boundary expression on the shell of this chunk.
+        std::shared_ptr<BCBetweenMask const> _shellMask;
 
-        NewBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode);
+        // For stats and trace; the cell-level counts of this iterator, added to the array stats at the end.
+        uint64_t _statCounts[BCBetweenStats::N_COUNTERS];
 
-    protected:
-        Value _value;
+    private:
+        std::shared_ptr<Query> _query;
     };
 
-    class EmptyBitmapBCBetweenChunkIterator : public NewBitmapBCBetweenChunkIterator
+    /**
+     * The chunk iterators of every role. Only getItem() is specialized by role: filter(), nextVisible(),
+     * moveNext() and jumpTo() are shared, in BCBetweenChunkIterator, by all of them. Under
+     * IGNORE_EMPTY_CELLS, the empty bitmap roles return a set bit without reading the input or filtering
+     * the cell again, since every cell they stop on already passed the filter.
+     */
+    template <BCBetweenChunkRole role>
+    class BCBetweenRoleChunkIterator final : public BCBetweenChunkIterator
     {
     public:
         virtual Value const& getItem();
-        virtual bool isEmpty() const;
 
-        EmptyBitmapBCBetweenChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode);
+        BCBetweenRoleChunkIterator(BCBetweenArrayIterator const& arrayIterator, BCBetweenChunk const& chunk, int iterationMode);
     };
 
+    typedef BCBetweenRoleChunkIterator<ROLE_DATA> DataBCBetweenChunkIterator;
+    typedef BCBetweenRoleChunkIterator<ROLE_EXISTED_BITMAP> ExistedBitmapBCBetweenChunkIterator;
+    typedef BCBetweenRoleChunkIterator<ROLE_NEW_BITMAP> NewBitmapBCBetweenChunkIterator;
+
 /**
  * ====== NOTE FROM Donghui Z. ON UNIFYING THE TWO ITERATORS ===========
  *
@@ -210,6 +402,7 @@ namespace scidb
     class BCBetweenArrayIterator : public DelegateArrayIterator
     {
         friend class BCBetweenChunkIterator;
+        friend class BCBetweenArray;
     public:
 
         /***
@@ -218,6 +411,7 @@ namespace scidb
          * attribute in the input array.
          */
         BCBetweenArrayIterator(BCBetweenArray const& between, AttributeID attrID, AttributeID inputAttrID);
+        virtual ~BCBetweenArrayIterator();
 
         /***
          * The end call checks whether we're operating with the last chunk of the between
@@ -253,6 +447,16 @@ namespace scidb
         bool setAllIteratorsPosition(Coordinates const& pos);
         void moveNext();
 
+        /**
+         * The input chunk at the current position; with a shared scan, the copy kept in _sharedChunk, if any.
+         */
+        ConstChunk const& getInputChunk();
+
+        /**
+         * In complement mode, walk the input chunks in order, skipping the ones fully inside the inner window.
+         */
+        void advanceToNextChunkOutsideInner();
+
     protected:
         BCBetweenArray const& _array;
         SpatialRangesChunkPosIteratorPtr _spatialRangesChunkPosIteratorPtr;
@@ -285,6 +489,10 @@ namespace scidb
         std::vector< std::shared_ptr<ConstArrayIterator> > _iterators;
         std::shared_ptr<ConstArrayIterator> _emptyBitmapIterator;
         AttributeID _inputAttrID;
+        std::shared_ptr<ConstChunk> _sharedChunk;
+        Coordinates _sharedChunkPos;        // the position _sharedChunk was got for
+        uint64_t _scanCursor;               // the cursor of this iterator in the shared scan
+        bool _scanCursorEnded;              // whether the cursor was moved past the last chunk
     };
 
     class BCBetweenArrayEmptyBitmapIterator : public BCBetweenArrayIterator
@@ -300,8 +508,7 @@ namespace scidb
         friend class BCBetweenChunk;
         friend class BCBetweenChunkIterator;
         friend class BCBetweenArrayIterator;
-        friend class ExistedBitmapBCBetweenChunkIterator;
-        friend class NewBitmapBCBetweenChunkIterator;
+        template <BCBetweenChunkRole role> friend class BCBetweenRoleChunkIterator;
 
     public:
         BCBetweenArray(ArrayDesc const& desc,
@@ -310,13 +517,93 @@ namespace scidb
                        std::shared_ptr<Array> const& input,
                        std::shared_ptr<Expression> expr,
                        std::shared_ptr<Query>& query,
-                       bool tileMode);
+                       bool tileMode,
+                       BCBetweenSettings const& settings);
+
+        virtual ~BCBetweenArray();
 
         virtual DelegateChunk* createChunk(DelegateArrayIterator const* iterator, AttributeID attrID) const;
         virtual DelegateArrayIterator* createArrayIterator(AttributeID attrID) const;
 
         std::shared_ptr<DelegateChunk> getEmptyBitmapChunk(BCBetweenArrayEmptyBitmapIterator* iterator);
+
+        /**
+         * Whether the chunk at chunkPos may hold an output cell.
+         * Normally, when it intersects the window. In complement mode, when it is not fully inside the inner window.
+         */
+        bool isChunkInRange(Coordinates const& chunkPos, size_t& hint) const;
+
+        /**
+         * Whether the input chunk at chunkPos may be stored on this instance.
+         * Always true when the input distribution does not tell.
+         */
+        bool isLocalChunk(Coordinates const& chunkPos) const;
+
+        /**
+         * Read the value of a neighbor binding at pos, which lies in another chunk than the current cell.
+         * Null if pos is outside the array or empty.
+         */
+        void getHaloValue(size_t binding, Coordinates const& pos, Value& result) const;
+
+        /**
+         * The chunk of a bound attribute at the current position of arrayIterator, fetched once
+         * for the iterators of all output attributes.
+         */
+        std::shared_ptr<ConstChunk> getBoundChunk(size_t binding, BCBetweenArrayIterator const& arrayIterator) const;
+
+        /**
+         * Whether the boundary expression has the same result on every cell of the chunk at the current
+         * position of arrayIterator, as proven by the zone map of its bound attributes.
+         * @param inputChunk the input chunk of arrayIterator.
+         * @param passes set to the result, when decided.
+         */
+        bool decideShell(BCBetweenArrayIterator const& arrayIterator, ConstChunk const& inputChunk, bool& passes) const;
+
+        /**
+         * The chunk of the new empty tag at the position of inputChunk, with every cell present.
+         */
+        std::shared_ptr<MemChunk> getFullBitmapChunk(ConstChunk const& inputChunk) const;
+
+        /**
+         * For the limit.
+         * Every chunk gets a budget of cells the first time it is iterated, out of what the chunks
+         * before it left; every attribute then keeps the same first cells of the chunk.
+         * findChunkBudget() sets budget to the budget of the chunk and returns true, or to what is left
+         * and returns false. commitChunkBudget() grants count cells, or what is left, to the chunk,
+         * unless another iterator did first, and returns the budget of the chunk.
+         */
+        bool findChunkBudget(Coordinates const& chunkPos, uint64_t& budget) const;
+        uint64_t commitChunkBudget(Coordinates const& chunkPos, uint64_t count) const;
+
+        /**
+         * Whether the chunk at chunkPos may hold an output cell within the limit.
+         */
+        bool isChunkWithinLimit(Coordinates const& chunkPos) const;
+
+        /**
+         * For reordering; the order of the terms, null until TERM_SAMPLES shell cells are measured.
+         * addTermSamples() adds the samples of a chunk iterator, and returns the order.
+         */
+        std::shared_ptr<std::vector<size_t> const> getTermOrder() const;
+        std::shared_ptr<std::vector<size_t> const> addTermSamples(std::vector<uint64_t> const& samples) const;
+
+        static const size_t TERM_SAMPLE_BATCH = 256;
+        static const uint64_t TERM_SAMPLES = 4096;
+
     private:
+        /**
+         * resolveNeighbors() and resolveTerms() take over what a prepared scaffold holds, if not null.
+         */
+        void resolveNeighbors(BCBetweenSettings const& settings, std::shared_ptr<Query> const& query,
+                              BCBetweenPrepared::Scaffold const* scaffold);
+        void resolveLocalDistribution(std::shared_ptr<Query> const& query);
+        void resolveMaskCache(BCBetweenSettings const& settings);
+        void resolvePrepared(BCBetweenSettings const& settings);
+        void resolveSharedScan(BCBetweenSettings const& settings);
+        void resolveZoneMap(BCBetweenSettings const& settings);
+        void resolveTerms(BCBetweenSettings const& settings, BCBetweenPrepared::Scaffold const* scaffold);
+        std::shared_ptr<BCBetweenHalo const> loadHalo(AttributeID attrID, Coordinates const& chunkPos) const;
+
         /**
          * The original spatial ranges.
          */
@@ -347,6 +634,119 @@ namespace scidb
         bool _tileMode;
         size_t cacheSize;
         AttributeID emptyAttrID;
+
+        /**
+         * For sampling
+         */
+        bool _sampled;
+        double _sampleRate;
+        uint64_t _sampleSeed;
+
+        /**
+         * For complement mode
+         */
+        bool _complement;
+
+        /**
+         * For neighbor bindings.
+         * _bindingOffsets[i] is the offset of binding i, or empty if binding i reads the cell itself.
+         * The halo cache keeps one edge slab per attribute and chunk, so that a chunk is read once for
+         * the lookups that cross into it, or by each thread that misses it at the same time.
+         */
+        std::vector<Coordinates> _bindingOffsets;
+        Coordinates _haloReach;
+        size_t _haloCacheSize;
+        mutable std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess> _haloCache;
+        mutable Mutex _haloMutex;
+
+        /**
+         * For bound attributes.
+         * The chunks of the bound attributes at the last positions, as read-only copies shared by the
+         * chunk iterators of every output attribute. At most cacheSize positions are kept. With a single
+         * output array iterator, nothing is copied nor kept.
+         */
+        typedef std::map<Coordinates, std::map<AttributeID, std::shared_ptr<ConstChunk> >, CoordinatesLess> BoundChunks;
+        mutable BoundChunks _boundChunks;
+        mutable std::deque<Coordinates> _boundOrder;
+        mutable Mutex _boundMutex;
+        mutable std::atomic<size_t> _nArrayIterators;
+
+        /**
+         * For local chunk enumeration.
+         * Set when the input is hash, row or column partitioned over the instances of the query,
+         * so that the chunk positions of the window held by other instances are never probed.
+         */
+        ArrayDistPtr _localDistribution;
+        size_t _nInstances;
+        InstanceID _instanceID;
+
+        /**
+         * For the mask cache; null unless 'cache_dir' is given and the input is a stored array version.
+         */
+        std::shared_ptr<BCBetweenMaskCache> _maskCache;
+
+        /**
+         * For prepared queries; the shape shared with the other queries of the same expression and neighbor
+         * bindings on the same stored array version. Null unless 'prepared=true' is given.
+         */
+        std::shared_ptr<BCBetweenPrepared> _prepared;
+
+        /**
+         * For the shared scan; the scan of the input array version and the id of this array in it.
+         * Null unless 'shared_scan=true' is given.
+         */
+        std::shared_ptr<BCBetweenSharedScan> _sharedScan;
+        uint64_t _scanReader;
+
+        /**
+         * For zone maps; null unless 'zone_map' is given and the expression only binds attributes
+         * at the cell itself. With _zoneMapConvex, a chunk whose min/max box passes at every corner passes.
+         */
+        std::shared_ptr<BCBetweenZoneMap> _zoneMap;
+        bool _zoneMapConvex;
+
+        /**
+         * For the limit; 0 without one.
+         */
+        uint64_t _limit;
+        mutable uint64_t _limitLeft;
+        mutable std::map<Coordinates, uint64_t, CoordinatesLess> _chunkBudgets;
+        mutable Mutex _limitMutex;
+
+        /**
+         * For reordering; the terms of the top-level and/or chain of the expression, compiled apart,
+         * and for every binding of a term, the binding of the expression that reads the same attribute.
+         * Empty unless 'reorder=true' is given and the expression is such a chain.
+         */
+        std::vector<std::shared_ptr<Expression> > _terms;
+        std::vector<std::vector<ssize_t> > _termBindings;
+        bool _termsAnd;
+        mutable std::vector<uint64_t> _termSamples;
+        mutable std::shared_ptr<std::vector<size_t> const> _termOrder;
+        mutable Mutex _termMutex;
+
+        /**
+         * For fully inside chunks of a new empty tag; the packed single-run bitmaps, by number of cells,
+         * so that every chunk of the same shape shares one.
+         */
+        mutable std::map<uint64_t, std::shared_ptr<std::vector<char> const> > _fullBitmaps;
+        mutable Mutex _fullBitmapMutex;
+
+        /**
+         * The box of more non-constant attributes than this has too many corners to evaluate.
+         */
+        static const size_t MAX_ZONE_MAP_RANGED = 10;
+
+        /**
+         * For stats; null unless 'stats=true' is given.
+         */
+        std::shared_ptr<BCBetweenStats> _stats;
+        std::string _queryID;
+
+        /**
+         * For trace; null unless 'trace' is given.
+         */
+        std::shared_ptr<BCBetweenTrace> _trace;
     };
 
 } //namespace
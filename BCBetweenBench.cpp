@@ -0,0 +1,570 @@
+/*
+ * BCBetweenBench.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenBench.cpp
+ *
+ * @brief Microbenchmarks of the chunk iteration of bc_between, outside of a SciDB cluster.
+ *
+ * Builds an in-memory input array (a MemArray of a fake single-instance query), wraps it in a
+ * BCBetweenArray and pulls every cell of every output attribute, as a consumer of the operator would.
+ *
+ * Every parameter is given as key=value, and may list several values separated by commas; every
+ * combination of the values is run:
+ *   - dims      : number of dimensions (default 2)
+ *   - size      : length of every dimension (default 1000)
+ *   - chunk     : chunk interval of every dimension (default 100)
+ *   - density   : fraction of non-empty cells (default 1,0.1)
+ *   - window    : length of the window, as a fraction of the dimension (default 0.5)
+ *   - placement : 'center', 'corner', or 'unaligned', with the window edges off the chunk grid (default center,unaligned)
+ *   - shell     : width of the shell, in cells (default 1,10)
+ *   - terms     : number of comparisons and-ed in the boundary expression (default 1,4)
+ *   - attrs     : number of double attributes (default 1,4)
+ *   - values    : 'random' cell values, or 'chunk', one value per attribute and chunk (default random)
+ *   - options   : operator options, several joined with '+', or 'none' (default none), e.g.
+ *                 options=none,zone_map=constant,reorder=true,shared_scan=true+limit=1000,sample=0.5
+ *   - repeat    : runs per combination; the median is reported (default 5)
+ *   - seed      : seed of the cell values and of the empty cells (default 0)
+ *
+ * Every combination is reported as one JSON object per line on the standard output, with its parameters,
+ * the number of output cells and the median, minimum and maximum time of a run in nanoseconds.
+ *
+ * After the timed runs, the output is checked against a brute-force filter of the window: every output
+ * cell must be present in the input and pass, and there must be as many as expected; with 'limit',
+ * at most the limit, and with 'sample', at most the passing cells. The bench exits with 1 on a mismatch.
+ * The constants of the expression and values=chunk with zone_map cover the decision of whole shell chunks.
+ */
+
+#include "BCBetweenArray.h"
+#include "BCBetweenSettings.h"
+#include "BCBetweenStats.h"
+#include <array/MemArray.h>
+#include <query/QueryProcessor.h>
+#include <MurmurHash/MurmurHash3.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace scidb;
+
+namespace
+{
+    struct BenchParams
+    {
+        size_t dims;
+        Coordinate size;
+        int64_t chunk;
+        double density;
+        double window;
+        std::string placement;
+        Coordinate shell;
+        size_t terms;
+        size_t attrs;
+        std::string values;
+        std::string options;
+        size_t repeat;
+        uint64_t seed;
+    };
+
+    std::vector<std::string> split(std::string const& text)
+    {
+        std::vector<std::string> values;
+        std::istringstream in(text);
+        std::string value;
+        while (std::getline(in, value, ','))
+        {
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    /**
+     * Uniform in [0, 1), the same for a given seed, stream and linear cell number.
+     */
+    double draw(uint64_t seed, uint64_t stream, uint64_t cell)
+    {
+        return (fmix(seed ^ fmix(stream ^ fmix(cell))) >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * The value of attribute attrID at pos.
+     */
+    double getValue(BenchParams const& p, AttributeID attrID, Coordinates const& pos)
+    {
+        uint64_t cell = 0;
+        for (size_t d = 0; d < p.dims; d++)
+        {
+            cell = cell * p.size + (p.values == "chunk" ? pos[d] / p.chunk : pos[d]);
+        }
+        return draw(p.seed, attrID, cell);
+    }
+
+    bool isPresent(BenchParams const& p, AttributeID emptyAttrID, Coordinates const& pos)
+    {
+        uint64_t cell = 0;
+        for (size_t d = 0; d < p.dims; d++)
+        {
+            cell = cell * p.size + pos[d];
+        }
+        return draw(p.seed, emptyAttrID, cell) < p.density;
+    }
+
+    ArrayDesc makeSchema(BenchParams const& p, std::shared_ptr<Query> const& query)
+    {
+        Attributes attrs;
+        for (size_t i = 0; i < p.attrs; i++)
+        {
+            std::ostringstream name;
+            name << "a" << i;
+            attrs.push_back(AttributeDesc(safe_static_cast<AttributeID>(i), name.str(), TID_DOUBLE, 0, 0));
+        }
+
+        Dimensions dims;
+        for (size_t d = 0; d < p.dims; d++)
+        {
+            std::ostringstream name;
+            name << "d" << d;
+            dims.push_back(DimensionDesc(name.str(), 0, p.size - 1, p.chunk, 0));
+        }
+
+        return addEmptyTagAttribute(ArrayDesc("bc_between_bench", attrs, dims,
+                                              createDistribution(psHashPartitioned), query->getDefaultArrayResidency()));
+    }
+
+    std::shared_ptr<Array> makeInput(BenchParams const& p, ArrayDesc const& desc, std::shared_ptr<Query> const& query)
+    {
+        std::shared_ptr<Array> input = std::make_shared<MemArray>(desc, query);
+        AttributeID emptyAttrID = desc.getEmptyBitmapAttribute()->getId();
+        std::vector<std::shared_ptr<ArrayIterator> > arrayIterators;
+        for (AttributeID attrID = 0; attrID <= emptyAttrID; attrID++)
+        {
+            arrayIterators.push_back(input->getIterator(attrID));
+        }
+
+        Coordinates chunkPos(p.dims, 0);
+        Coordinates pos(p.dims);
+        Value value;
+        Value present;
+        present.setBool(true);
+        while (chunkPos[0] < p.size)
+        {
+            for (AttributeID attrID = 0; attrID <= emptyAttrID; attrID++)
+            {
+                Chunk& chunk = arrayIterators[attrID]->newChunk(chunkPos);
+                int mode = ChunkIterator::SEQUENTIAL_WRITE | (attrID == emptyAttrID ? 0 : ChunkIterator::NO_EMPTY_CHECK);
+                std::shared_ptr<ChunkIterator> chunkIterator = chunk.getIterator(query, mode);
+
+                // Row-major over the cells of the chunk.
+                pos = chunkPos;
+                while (pos[0] < std::min<Coordinate>(chunkPos[0] + p.chunk, p.size))
+                {
+                    if (isPresent(p, emptyAttrID, pos))
+                    {
+                        chunkIterator->setPosition(pos);
+                        if (attrID == emptyAttrID)
+                        {
+                            chunkIterator->writeItem(present);
+                        } else
+                        {
+                            value.setDouble(getValue(p, attrID, pos));
+                            chunkIterator->writeItem(value);
+                        }
+                    }
+
+                    size_t d = p.dims - 1;
+                    while (++pos[d] >= std::min<Coordinate>(chunkPos[d] + p.chunk, p.size) && d > 0)
+                    {
+                        pos[d] = chunkPos[d];
+                        d--;
+                    }
+                }
+                chunkIterator->flush();
+            }
+
+            size_t d = p.dims - 1;
+            while ((chunkPos[d] += p.chunk) >= p.size && d > 0)
+            {
+                chunkPos[d] = 0;
+                d--;
+            }
+        }
+        return input;
+    }
+
+    /**
+     * The term-th comparison of the boundary expression. Each passes on about 95% of the cells.
+     */
+    std::string getTerm(BenchParams const& p, size_t term)
+    {
+        std::ostringstream text;
+        text << "a" << term % p.attrs << (term % 2 ? " < 0.95" : " > 0.05");
+        return text.str();
+    }
+
+    bool passesTerm(BenchParams const& p, size_t term, Coordinates const& pos)
+    {
+        double value = getValue(p, safe_static_cast<AttributeID>(term % p.attrs), pos);
+        return term % 2 ? value < 0.95 : value > 0.05;
+    }
+
+    std::shared_ptr<Expression> compile(std::string const& text, TypeId const& type, ArrayDesc const& desc)
+    {
+        std::shared_ptr<Expression> expression = std::make_shared<Expression>();
+        expression->compile(parseExpression(text), false, type, std::vector<ArrayDesc>(1, desc), desc);
+        return expression;
+    }
+
+    /**
+     * The boundary expression: terms comparisons of the attributes in turn, and-ed.
+     */
+    std::shared_ptr<Expression> makeExpression(BenchParams const& p, ArrayDesc const& desc)
+    {
+        std::ostringstream text;
+        for (size_t term = 0; term < p.terms; term++)
+        {
+            text << (term ? " and " : "") << getTerm(p, term);
+        }
+        return compile(text.str(), TID_BOOL, desc);
+    }
+
+    /**
+     * The operator parameters for p.options, after the window that is given apart: the options as
+     * string constants and, for 'reorder=true', the terms the logical operator would append.
+     */
+    std::vector<std::shared_ptr<OperatorParam> > makeParameters(BenchParams const& p, ArrayDesc const& desc)
+    {
+        std::vector<std::shared_ptr<OperatorParam> > parameters(p.dims * 2 + 1);
+        std::vector<std::string> options;
+        std::istringstream in(p.options);
+        std::string option;
+        while (std::getline(in, option, '+'))
+        {
+            if (option != "none")
+            {
+                options.push_back(option);
+            }
+        }
+        bool reorder = std::find(options.begin(), options.end(), "reorder=true") != options.end();
+        if (reorder && p.terms > 1)
+        {
+            options.push_back("_terms=and");
+        }
+
+        for (size_t i = 0, n = options.size(); i < n; i++)
+        {
+            parameters.push_back(std::make_shared<OperatorParamPhysicalExpression>(
+                    std::shared_ptr<ParsingContext>(), compile("'" + options[i] + "'", TID_STRING, desc), true));
+        }
+        for (size_t term = 0; reorder && p.terms > 1 && term < p.terms; term++)
+        {
+            parameters.push_back(std::make_shared<OperatorParamPhysicalExpression>(
+                    std::shared_ptr<ParsingContext>(), compile(getTerm(p, term), TID_BOOL, desc), false));
+        }
+        return parameters;
+    }
+
+    /**
+     * Row-major linear index of pos inside the box [low, high].
+     */
+    uint64_t getIndex(Coordinates const& pos, Coordinates const& low, Coordinates const& high)
+    {
+        uint64_t index = 0;
+        for (size_t d = 0, n = pos.size(); d < n; d++)
+        {
+            index = index * (high[d] - low[d] + 1) + (pos[d] - low[d]);
+        }
+        return index;
+    }
+
+    /**
+     * Brute-force filter: which cells of the window [low, high] bc_between keeps, by linear index.
+     */
+    std::vector<bool> filter(BenchParams const& p, AttributeID emptyAttrID,
+                             Coordinates const& low, Coordinates const& high,
+                             Coordinates const& innerLow, Coordinates const& innerHigh)
+    {
+        std::vector<bool> kept(getIndex(high, low, high) + 1, false);
+        Coordinates pos = low;
+        while (true)
+        {
+            if (isPresent(p, emptyAttrID, pos))
+            {
+                bool inner = true;
+                for (size_t d = 0; d < p.dims; d++)
+                {
+                    inner = inner && pos[d] >= innerLow[d] && pos[d] <= innerHigh[d];
+                }
+                bool passed = true;
+                for (size_t term = 0; !inner && passed && term < p.terms; term++)
+                {
+                    passed = passesTerm(p, term, pos);
+                }
+                kept[getIndex(pos, low, high)] = passed;
+            }
+
+            size_t d = p.dims;
+            while (d > 0 && ++pos[d - 1] > high[d - 1])
+            {
+                pos[d - 1] = low[d - 1];
+                d--;
+            }
+            if (d == 0)
+            {
+                return kept;
+            }
+        }
+    }
+
+    /**
+     * Check every output attribute against the brute-force filter.
+     * @return the number of cells of the first attribute.
+     */
+    uint64_t check(BenchParams const& p, Array const& output, std::vector<bool> const& kept,
+                   Coordinates const& low, Coordinates const& high)
+    {
+        uint64_t expected = std::count(kept.begin(), kept.end(), true);
+        uint64_t limit = p.options.find("limit=") == std::string::npos ? 0 :
+                         std::strtoull(p.options.c_str() + p.options.find("limit=") + 6, NULL, 10);
+        bool sampled = p.options.find("sample") != std::string::npos;
+
+        uint64_t cells = 0;
+        int mode = ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS;
+        Attributes const& attrs = output.getArrayDesc().getAttributes();
+        for (AttributeID attrID = 0, n = safe_static_cast<AttributeID>(attrs.size()); attrID < n; attrID++)
+        {
+            uint64_t count = 0;
+            for (std::shared_ptr<ConstArrayIterator> arrayIterator = output.getConstIterator(attrID);
+                 !arrayIterator->end(); ++(*arrayIterator))
+            {
+                std::shared_ptr<ConstChunkIterator> chunkIterator = arrayIterator->getChunk().getConstIterator(mode);
+                for (; !chunkIterator->end(); ++(*chunkIterator))
+                {
+                    Coordinates const& pos = chunkIterator->getPosition();
+                    bool inWindow = true;
+                    for (size_t d = 0; d < p.dims; d++)
+                    {
+                        inWindow = inWindow && pos[d] >= low[d] && pos[d] <= high[d];
+                    }
+                    if (!inWindow || !kept[getIndex(pos, low, high)])
+                    {
+                        throw std::runtime_error("check failed: an output cell does not pass the brute-force filter");
+                    }
+                    if (!attrs[attrID].isEmptyIndicator() &&
+                        chunkIterator->getItem().getDouble() != getValue(p, attrID, pos))
+                    {
+                        throw std::runtime_error("check failed: an output value differs from the input");
+                    }
+                    count++;
+                }
+            }
+            if (attrID == 0)
+            {
+                cells = count;
+            } else if (count != cells)
+            {
+                throw std::runtime_error("check failed: the output attributes have different cells");
+            }
+        }
+
+        uint64_t bound = limit ? std::min(limit, expected) : expected;
+        if (sampled ? cells > bound : cells != bound)
+        {
+            std::ostringstream message;
+            message << "check failed: " << cells << " output cells, " << expected << " pass the brute-force filter";
+            throw std::runtime_error(message.str());
+        }
+        return expected;
+    }
+
+    /**
+     * Pull every cell of every output attribute.
+     * @return the number of cells of the first attribute.
+     */
+    uint64_t consume(Array const& output)
+    {
+        uint64_t cells = 0;
+        int mode = ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS;
+        Attributes const& attrs = output.getArrayDesc().getAttributes();
+        for (AttributeID attrID = 0, n = safe_static_cast<AttributeID>(attrs.size()); attrID < n; attrID++)
+        {
+            uint64_t count = 0;
+            for (std::shared_ptr<ConstArrayIterator> arrayIterator = output.getConstIterator(attrID);
+                 !arrayIterator->end(); ++(*arrayIterator))
+            {
+                std::shared_ptr<ConstChunkIterator> chunkIterator = arrayIterator->getChunk().getConstIterator(mode);
+                for (; !chunkIterator->end(); ++(*chunkIterator))
+                {
+                    chunkIterator->getItem();
+                    count++;
+                }
+            }
+            if (attrID == 0)
+            {
+                cells = count;
+            }
+        }
+        return cells;
+    }
+
+    void run(BenchParams const& p, std::shared_ptr<Query> query)
+    {
+        ArrayDesc desc = makeSchema(p, query);
+        std::shared_ptr<Array> input = makeInput(p, desc, query);
+        std::shared_ptr<Expression> expression = makeExpression(p, desc);
+
+        Coordinate length = std::max<Coordinate>(1, static_cast<Coordinate>(p.window * p.size));
+        Coordinate start = p.placement == "corner" ? 0 : (p.size - length) / 2;
+        if (p.placement == "unaligned")
+        {
+            start = start / p.chunk * p.chunk + p.chunk / 2 + 1;
+        }
+        Coordinates low(p.dims, start);
+        Coordinates high(p.dims, std::min<Coordinate>(start + length, p.size) - 1);
+        Coordinates innerLow(p.dims, start + p.shell);
+        Coordinates innerHigh(p.dims, high[0] - p.shell);
+
+        SpatialRangesPtr window = std::make_shared<SpatialRanges>(p.dims);
+        SpatialRangesPtr inner = std::make_shared<SpatialRanges>(p.dims);
+        window->insert(SpatialRange(low, high));
+        window->buildIndex();
+        if (innerLow[0] <= innerHigh[0])
+        {
+            inner->insert(SpatialRange(innerLow, innerHigh));
+            inner->buildIndex();
+        }
+
+        BCBetweenSettings settings(makeParameters(p, desc), false, query, p.dims);
+
+        uint64_t cells = 0;
+        std::vector<uint64_t> nanos;
+        for (size_t i = 0; i < p.repeat; i++)
+        {
+            uint64_t begin = BCBetweenStats::now();
+            std::shared_ptr<Array> output =
+                    std::make_shared<BCBetweenArray>(desc, window, inner, input, expression, query, false, settings);
+            cells = consume(*output);
+            nanos.push_back(BCBetweenStats::now() - begin);
+        }
+        std::sort(nanos.begin(), nanos.end());
+
+        std::vector<bool> kept = filter(p, desc.getEmptyBitmapAttribute()->getId(), low, high, innerLow, innerHigh);
+        uint64_t expected = check(p, *std::make_shared<BCBetweenArray>(desc, window, inner, input, expression,
+                                                                        query, false, settings),
+                                  kept, low, high);
+
+        std::cout << "{\"dims\": " << p.dims << ", \"size\": " << p.size << ", \"chunk\": " << p.chunk
+                  << ", \"density\": " << p.density << ", \"window\": " << p.window
+                  << ", \"placement\": \"" << p.placement << "\", \"shell\": " << p.shell
+                  << ", \"terms\": " << p.terms << ", \"attrs\": " << p.attrs
+                  << ", \"values\": \"" << p.values << "\", \"options\": \"" << p.options << "\""
+                  << ", \"cells\": " << cells << ", \"expected\": " << expected << ", \"median_ns\": " << nanos[nanos.size() / 2]
+                  << ", \"min_ns\": " << nanos.front() << ", \"max_ns\": " << nanos.back() << "}" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::map<std::string, std::string> args;
+    args["dims"] = "2";
+    args["size"] = "1000";
+    args["chunk"] = "100";
+    args["density"] = "1,0.1";
+    args["window"] = "0.5";
+    args["placement"] = "center,unaligned";
+    args["shell"] = "1,10";
+    args["terms"] = "1,4";
+    args["attrs"] = "1,4";
+    args["values"] = "random";
+    args["options"] = "none";
+    args["repeat"] = "5";
+    args["seed"] = "0";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos || !args.count(arg.substr(0, eq)))
+        {
+            std::cerr << "bc_between_bench: unknown argument '" << arg << "'" << std::endl;
+            return 1;
+        }
+        args[arg.substr(0, eq)] = arg.substr(eq + 1);
+    }
+
+    std::shared_ptr<InstanceLiveness> liveness = std::make_shared<InstanceLiveness>(0, 0);
+    InstanceLivenessEntry self(0, 0, false);
+    liveness->insert(&self);
+    std::shared_ptr<Query> query = Query::createFakeQuery(0, 0, liveness);
+
+    // Every combination of the listed values, the last key varying fastest.
+    std::vector<std::string> keys;
+    std::vector<std::vector<std::string> > values;
+    for (std::map<std::string, std::string>::const_iterator it = args.begin(); it != args.end(); ++it)
+    {
+        keys.push_back(it->first);
+        values.push_back(split(it->second));
+        if (values.back().empty())
+        {
+            std::cerr << "bc_between_bench: no value for '" << it->first << "'" << std::endl;
+            return 1;
+        }
+    }
+    std::vector<size_t> index(keys.size(), 0);
+    while (true)
+    {
+        std::map<std::string, std::string> chosen;
+        for (size_t k = 0; k < keys.size(); k++)
+        {
+            chosen[keys[k]] = values[k][index[k]];
+        }
+
+        BenchParams p;
+        p.dims = std::strtoul(chosen["dims"].c_str(), NULL, 10);
+        p.size = std::strtoll(chosen["size"].c_str(), NULL, 10);
+        p.chunk = std::strtoll(chosen["chunk"].c_str(), NULL, 10);
+        p.density = std::strtod(chosen["density"].c_str(), NULL);
+        p.window = std::strtod(chosen["window"].c_str(), NULL);
+        p.placement = chosen["placement"];
+        p.shell = std::strtoll(chosen["shell"].c_str(), NULL, 10);
+        p.terms = std::strtoul(chosen["terms"].c_str(), NULL, 10);
+        p.attrs = std::strtoul(chosen["attrs"].c_str(), NULL, 10);
+        p.values = chosen["values"];
+        p.options = chosen["options"];
+        p.repeat = std::strtoul(chosen["repeat"].c_str(), NULL, 10);
+        p.seed = std::strtoull(chosen["seed"].c_str(), NULL, 10);
+        if (p.dims == 0 || p.size <= 0 || p.chunk <= 0 || p.terms == 0 || p.attrs == 0 || p.repeat == 0 ||
+            (p.placement != "center" && p.placement != "corner" && p.placement != "unaligned") ||
+            (p.values != "random" && p.values != "chunk"))
+        {
+            std::cerr << "bc_between_bench: invalid parameters" << std::endl;
+            return 1;
+        }
+
+        try
+        {
+            run(p, query);
+        } catch (std::exception const& e)
+        {
+            std::cerr << "bc_between_bench: " << e.what() << std::endl;
+            return 1;
+        }
+
+        size_t k = keys.size();
+        while (k > 0 && ++index[k - 1] == values[k - 1].size())
+        {
+            index[--k] = 0;
+        }
+        if (k == 0)
+        {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,480 @@
+/*
+ * BCBetweenExport.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenExport.h"
+#include <system/Exceptions.h>
+#include <array/RLE.h>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+namespace scidb
+{
+    BCBetweenExporter::BCBetweenExporter(std::shared_ptr<BCBetweenArray> const& array,
+                                         Coordinates const& lowPos,
+                                         Coordinates const& highPos,
+                                         std::string const& prefix,
+                                         std::shared_ptr<Query> const& query)
+            : _array(array),
+              _lowPos(lowPos),
+              _highPos(highPos),
+              _strides(lowPos.size()),
+              _volume(1),
+              _prefix(prefix)
+    {
+        _mask.data = NULL;
+        _mask.size = 0;
+        if (!isDominatedBy(_lowPos, _highPos))
+        {
+            _volume = 0;
+        }
+        for (size_t i = lowPos.size(); i-- > 0 && _volume > 0; )
+        {
+            _strides[i] = _volume;
+            uint64_t length = static_cast<uint64_t>(highPos[i] - lowPos[i] + 1);
+            if (_volume > std::numeric_limits<uint64_t>::max() / length)
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: the export window has too many cells";
+            }
+            _volume *= length;
+        }
+
+        std::ostringstream filePrefix;
+        filePrefix << _prefix << "." << query->getQueryID();
+        _filePrefix = filePrefix.str();
+    }
+
+    void BCBetweenExporter::exportWindow()
+    {
+        checkSize();
+
+        ArrayDesc const& desc = _array->getArrayDesc();
+        Attributes const& attrs = desc.getAttributes();
+        std::shared_ptr<Array> input = _array->getInputArray();
+        std::vector<std::shared_ptr<ConstArrayIterator> > inputIterators(attrs.size());
+        _data.resize(attrs.size());
+        _nulls.resize(attrs.size());
+        for (size_t i = 0, n = attrs.size(); i < n; i++)
+        {
+            _data[i].data = NULL;
+            _nulls[i].data = NULL;
+            if (attrs[i].isEmptyIndicator())
+            {
+                continue;
+            }
+            Type const& type = TypeLibrary::getType(attrs[i].getType());
+            std::string path = _filePrefix + "." + attrs[i].getName();
+            _data[i] = mapFile(path, _volume * type.byteSize());
+            if (attrs[i].isNullable())
+            {
+                _nulls[i] = mapFile(path + ".nulls", (_volume + 7) / 8);
+            }
+            inputIterators[i] = input->getConstIterator(attrs[i].getId());
+        }
+        _mask = mapFile(_filePrefix + ".mask", (_volume + 7) / 8);
+
+        // The output empty tag walks the chunks of the window; on a partial chunk, it yields the cells that
+        // the shell mask keeps. The values are then copied from the input chunks of every attribute.
+        std::shared_ptr<ConstArrayIterator> tagIterator = _volume > 0
+                ? _array->getConstIterator(desc.getEmptyBitmapAttribute()->getId())
+                : std::shared_ptr<ConstArrayIterator>();
+        std::vector<Run> runs;
+        BCBetweenMask kept;
+        for (; tagIterator && !tagIterator->end(); ++(*tagIterator))
+        {
+            Coordinates const& chunkPos = tagIterator->getPosition();
+            BCBetweenChunk const& tagChunk = static_cast<BCBetweenChunk const&>(tagIterator->getChunk());
+            ConstChunk const& inputChunk = tagChunk.getInputChunk();
+
+            BCBetweenMask const* keptPtr = NULL;
+            if (!tagChunk.isFullyInside())
+            {
+                CoordinatesMapper mapper(inputChunk);
+                kept.assign((inputChunk.getNumberOfElements(true) + 7) / 8, 0);
+                bool any = false;
+                std::shared_ptr<ConstChunkIterator> tagChunkIterator = tagChunk.getConstIterator(
+                        ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+                for (; !tagChunkIterator->end(); ++(*tagChunkIterator))
+                {
+                    BCBetweenMaskCache::set(kept, mapper.coord2pos(tagChunkIterator->getPosition()));
+                    any = true;
+                }
+                if (!any)
+                {
+                    continue;
+                }
+                keptPtr = &kept;
+            }
+
+            // Every attribute chunk of the position has the same empty bitmap, so the same runs.
+            bool first = true;
+            for (size_t i = 0, n = attrs.size(); i < n; i++)
+            {
+                if (!inputIterators[i])
+                {
+                    continue;
+                }
+                if (!inputIterators[i]->setPosition(chunkPos))
+                    throw USER_EXCEPTION(SCIDB_SE_EXECUTION, SCIDB_LE_OPERATION_FAILED) << "setPosition";
+                ConstChunk const* chunk = inputIterators[i]->getChunk().materialize();
+                PinBuffer scope(*chunk);
+                if (first)
+                {
+                    getRuns(*chunk, keptPtr, runs);
+                    for (size_t r = 0, m = runs.size(); r < m; r++)
+                    {
+                        setBits(_mask.data, runs[r].index, runs[r].length);
+                    }
+                    first = false;
+                }
+                copyRuns(*chunk, attrs[i], runs);
+            }
+        }
+
+        for (size_t i = 0, n = attrs.size(); i < n; i++)
+        {
+            unmapFile(_data[i]);
+            unmapFile(_nulls[i]);
+        }
+        unmapFile(_mask);
+    }
+
+    uint64_t BCBetweenExporter::getIndex(Coordinates const& pos) const
+    {
+        uint64_t index = 0;
+        for (size_t i = 0, n = pos.size(); i < n; i++)
+        {
+            index += static_cast<uint64_t>(pos[i] - _lowPos[i]) * _strides[i];
+        }
+        return index;
+    }
+
+    void BCBetweenExporter::checkSize() const
+    {
+        uint64_t maskSize = (_volume + 7) / 8;
+        uint64_t total = maskSize;
+        Attributes const& attrs = _array->getArrayDesc().getAttributes();
+        for (size_t i = 0, n = attrs.size(); i < n; i++)
+        {
+            if (attrs[i].isEmptyIndicator())
+            {
+                continue;
+            }
+            Type const& type = TypeLibrary::getType(attrs[i].getType());
+            if (type.variableSize())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: export needs fixed-size attributes, '" + attrs[i].getName() + "' is not";
+            }
+            uint64_t size = _volume * type.byteSize();
+            if (type.byteSize() != 0 && size / type.byteSize() != _volume)
+            {
+                total = std::numeric_limits<uint64_t>::max();
+                break;
+            }
+            total += std::min(size, std::numeric_limits<uint64_t>::max() - total);
+            if (attrs[i].isNullable())
+            {
+                total += std::min(maskSize, std::numeric_limits<uint64_t>::max() - total);
+            }
+        }
+
+        // Every instance maps every file whole, so they must fit in the address space, and once written,
+        // on the file system.
+        size_t slash = _prefix.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : _prefix.substr(0, slash);
+        struct statvfs fs;
+        uint64_t available = ::statvfs(dir.c_str(), &fs) == 0
+                ? static_cast<uint64_t>(fs.f_bavail) * fs.f_frsize
+                : std::numeric_limits<uint64_t>::max();
+        if (total > std::numeric_limits<size_t>::max() / 2 || total > available)
+        {
+            std::ostringstream oss;
+            oss << "bc_between: the export of " << _volume << " cells needs " << total
+                << " bytes, more than the " << available << " available in " << dir;
+            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION) << oss.str();
+        }
+    }
+
+    void BCBetweenExporter::getRuns(ConstChunk const& chunk, BCBetweenMask const* kept, std::vector<Run>& runs) const
+    {
+        runs.clear();
+        Coordinates const& first = chunk.getFirstPosition(true);
+        Coordinates const& last = chunk.getLastPosition(true);
+        Coordinates const& coreFirst = chunk.getFirstPosition(false);
+        Coordinates const& coreLast = chunk.getLastPosition(false);
+        size_t nDims = first.size();
+        size_t lastDim = nDims - 1;
+
+        // The box of the chunk, without the overlap, within the window.
+        Coordinates low(nDims), high(nDims);
+        for (size_t d = 0; d < nDims; d++)
+        {
+            low[d] = std::max(coreFirst[d], _lowPos[d]);
+            high[d] = std::min(coreLast[d], _highPos[d]);
+            if (low[d] > high[d])
+            {
+                return;
+            }
+        }
+
+        // Without an empty bitmap, every cell is in the payload.
+        std::shared_ptr<ConstRLEEmptyBitmap> bitmap = chunk.getEmptyBitmap();
+        ConstRLEEmptyBitmap::Segment full;
+        full._lPosition = 0;
+        full._length = chunk.getNumberOfElements(true);
+        full._pPosition = 0;
+        size_t nSegments = bitmap ? bitmap->nSegments() : 1;
+
+        CoordinatesMapper mapper(first, last);
+        Coordinates coords(nDims);
+        for (size_t i = 0; i < nSegments; i++)
+        {
+            ConstRLEEmptyBitmap::Segment const& segment = bitmap ? bitmap->getSegment(i) : full;
+            position_t end = segment._lPosition + segment._length;
+            for (position_t pos = segment._lPosition; pos < end; )
+            {
+                // The part of the segment on the row of pos.
+                mapper.pos2coord(pos, coords);
+                Coordinate rowStart = coords[lastDim];
+                position_t length = std::min<position_t>(last[lastDim] - rowStart + 1, end - pos);
+                bool inRow = true;
+                for (size_t d = 0; d < lastDim && inRow; d++)
+                {
+                    inRow = coords[d] >= low[d] && coords[d] <= high[d];
+                }
+                Coordinate from = std::max(rowStart, low[lastDim]);
+                Coordinate to = std::min<Coordinate>(rowStart + length - 1, high[lastDim]);
+                for (Coordinate c = from; inRow && c <= to; )
+                {
+                    // The next run of kept cells on the row.
+                    position_t offset = c - rowStart;
+                    if (kept && !BCBetweenMaskCache::test(*kept, pos + offset))
+                    {
+                        c++;
+                        continue;
+                    }
+                    Coordinate runEnd = c + 1;
+                    while (runEnd <= to && (!kept || BCBetweenMaskCache::test(*kept, pos + (runEnd - rowStart))))
+                    {
+                        runEnd++;
+                    }
+                    coords[lastDim] = c;
+                    Run run;
+                    run.pPosition = segment._pPosition + (pos - segment._lPosition) + offset;
+                    run.index = getIndex(coords);
+                    run.length = static_cast<uint64_t>(runEnd - c);
+                    runs.push_back(run);
+                    c = runEnd;
+                }
+                pos += length;
+            }
+        }
+    }
+
+    void BCBetweenExporter::copyRuns(ConstChunk const& chunk, AttributeDesc const& attr, std::vector<Run> const& runs)
+    {
+        char* data = _data[attr.getId()].data;
+        char* nulls = _nulls[attr.getId()].data;
+        size_t cellSize = TypeLibrary::getType(attr.getType()).byteSize();
+        ConstRLEPayload payload(static_cast<char const*>(chunk.getData()));
+        ConstRLEPayload::iterator it = payload.getIterator();
+        for (size_t r = 0, m = runs.size(); r < m; r++)
+        {
+            Run const& run = runs[r];
+            if (!it.setPosition(run.pPosition))
+            {
+                continue;
+            }
+
+            // A run may span several payload segments: null, repeated, or literal values stored back to back.
+            for (uint64_t done = 0; done < run.length && !it.end(); )
+            {
+                uint64_t length = std::min<uint64_t>(run.length - done, it.available());
+                uint64_t index = run.index + done;
+                if (it.isNull())
+                {
+                    if (nulls)
+                    {
+                        setBits(nulls, index, length);
+                    }
+                } else if (payload.isBool())
+                {
+                    ConstRLEPayload::iterator bit = it;
+                    for (uint64_t k = 0; k < length; k++, ++bit)
+                    {
+                        data[index + k] = bit.checkBit();
+                    }
+                } else
+                {
+                    size_t valueSize = 0;
+                    char const* value = it.getRawValue(valueSize);
+                    if (it.isSame())
+                    {
+                        for (uint64_t k = 0; k < length; k++)
+                        {
+                            memcpy(data + (index + k) * cellSize, value, cellSize);
+                        }
+                    } else
+                    {
+                        memcpy(data + index * cellSize, value, length * cellSize);
+                    }
+                }
+                it += length;
+                done += length;
+            }
+        }
+    }
+
+    void BCBetweenExporter::setBits(char* data, uint64_t index, uint64_t length)
+    {
+        // Chunks of other instances may share the first and the last byte.
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+        uint64_t end = index + length;
+        while (index < end && (index % 8 != 0 || end - index < 8))
+        {
+            __sync_fetch_and_or(bytes + index / 8, static_cast<uint8_t>(1 << (index % 8)));
+            index++;
+        }
+        if (index < end)
+        {
+            uint64_t whole = (end - index) / 8;
+            memset(bytes + index / 8, 0xff, whole);
+            index += whole * 8;
+        }
+        for (; index < end; index++)
+        {
+            __sync_fetch_and_or(bytes + index / 8, static_cast<uint8_t>(1 << (index % 8)));
+        }
+    }
+
+    void BCBetweenExporter::writeDescription() const
+    {
+        std::string path = _prefix + ".json";
+        std::ofstream out(path.c_str());
+        if (!out)
+        {
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_CANT_OPEN_FILE) << path << ::strerror(errno) << errno;
+        }
+
+        out << "{\n  \"shape\": [";
+        for (size_t i = 0, n = _lowPos.size(); i < n; i++)
+        {
+            out << (i ? ", " : "") << (isDominatedBy(_lowPos, _highPos) ? _highPos[i] - _lowPos[i] + 1 : 0);
+        }
+        out << "],\n  \"origin\": [";
+        for (size_t i = 0, n = _lowPos.size(); i < n; i++)
+        {
+            out << (i ? ", " : "") << _lowPos[i];
+        }
+        out << "],\n  \"mask\": \"" << _filePrefix << ".mask\",\n  \"attributes\": {";
+
+        Attributes const& attrs = _array->getArrayDesc().getAttributes();
+        bool first = true;
+        for (size_t i = 0, n = attrs.size(); i < n; i++)
+        {
+            if (attrs[i].isEmptyIndicator())
+            {
+                continue;
+            }
+            out << (first ? "\n" : ",\n") << "    \"" << attrs[i].getName() << "\": {\"file\": \""
+                << _filePrefix << "." << attrs[i].getName() << "\", \"dtype\": \""
+                << getDType(TypeLibrary::getType(attrs[i].getType())) << "\"";
+            if (attrs[i].isNullable())
+            {
+                out << ", \"nulls\": \"" << _filePrefix << "." << attrs[i].getName() << ".nulls\"";
+            }
+            out << "}";
+            first = false;
+        }
+        out << "\n  }\n}\n";
+    }
+
+    BCBetweenExporter::Buffer BCBetweenExporter::mapFile(std::string const& path, size_t size)
+    {
+        Buffer buffer;
+        buffer.path = path;
+        buffer.data = NULL;
+        buffer.size = size;
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_CANT_OPEN_FILE) << path << ::strerror(errno) << errno;
+        }
+
+        // The files are named by query, so they start empty. Every instance grows the file to the same size;
+        // ftruncate never shrinks data written by another one.
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size && ::ftruncate(fd, size) != 0))
+        {
+            int err = errno;
+            ::close(fd);
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_FILE_WRITE_ERROR) << ::strerror(err) << err;
+        }
+        if (size == 0)
+        {
+            ::close(fd);
+            return buffer;
+        }
+
+        void* data = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_FILE_WRITE_ERROR) << ::strerror(err) << err;
+        }
+        buffer.data = static_cast<char*>(data);
+        return buffer;
+    }
+
+    void BCBetweenExporter::unmapFile(Buffer& buffer)
+    {
+        if (buffer.data == NULL)
+        {
+            return;
+        }
+        char* data = buffer.data;
+        buffer.data = NULL;
+        if (::msync(data, buffer.size, MS_SYNC) != 0)
+        {
+            int err = errno;
+            ::munmap(data, buffer.size);
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_FILE_WRITE_ERROR) << ::strerror(err) << err;
+        }
+        ::munmap(data, buffer.size);
+    }
+
+    std::string BCBetweenExporter::getDType(Type const& type)
+    {
+        TypeId const& id = type.typeId();
+        if (id == TID_BOOL)   return "bool";
+        if (id == TID_INT8)   return "int8";
+        if (id == TID_INT16)  return "int16";
+        if (id == TID_INT32)  return "int32";
+        if (id == TID_INT64)  return "int64";
+        if (id == TID_UINT8)  return "uint8";
+        if (id == TID_UINT16) return "uint16";
+        if (id == TID_UINT32) return "uint32";
+        if (id == TID_UINT64) return "uint64";
+        if (id == TID_FLOAT)  return "float32";
+        if (id == TID_DOUBLE) return "float64";
+
+        // Any other fixed-size type is exported as raw bytes.
+        std::ostringstream oss;
+        oss << "V" << type.byteSize();
+        return oss.str();
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * BCBetweenExport.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenExport.h
+ *
+ * @brief Dense tensor export of the bc_between window.
+ *
+ * Every fixed-size attribute is written as a row-major dense buffer over the window box
+ * into a memory-mapped local file named <prefix>.<query>.<attribute>. The empty tag becomes a
+ * packed validity mask in <prefix>.<query>.mask, one bit per cell, least significant bit first.
+ * Every nullable attribute also gets a packed null mask in <prefix>.<query>.<attribute>.nulls, with
+ * the bit of a valid cell set when its value is null. The files of every query are new, so cells that
+ * are empty or null are left zero in the attribute buffers; the files of earlier queries are left for
+ * the caller to remove.
+ *
+ * The values are copied from the payload of the input chunks, a run of cells at a time, without
+ * going through the chunk iterators: all of a fully inside chunk, and the cells of a partial chunk
+ * that its shell mask keeps. The shell mask is read once per chunk from the output empty tag, so the
+ * boundary expression is evaluated once per cell whatever the number of attributes.
+ *
+ * Every instance maps the same files and writes the cells of its own chunks, so on a single
+ * host the files hold the whole window once the query completes. Once every instance is done, the
+ * coordinator writes <prefix>.json, which describes the shape and element types of the buffers and
+ * names the files of the last query.
+ */
+
+#ifndef BC_BETWEEN_EXPORT_H_
+#define BC_BETWEEN_EXPORT_H_
+
+#include <array/Array.h>
+#include <array/Metadata.h>
+#include <query/Operator.h>
+#include <string>
+#include <vector>
+#include "BCBetweenArray.h"
+
+namespace scidb
+{
+    class BCBetweenExporter
+    {
+    public:
+        /**
+         * @param array the output of bc_between.
+         * @param lowPos the low coordinates of the window box.
+         * @param highPos the high coordinates of the window box.
+         * @param prefix the path prefix of the files to write.
+         * @param query the current query.
+         */
+        BCBetweenExporter(std::shared_ptr<BCBetweenArray> const& array,
+                          Coordinates const& lowPos,
+                          Coordinates const& highPos,
+                          std::string const& prefix,
+                          std::shared_ptr<Query> const& query);
+
+        /**
+         * Write the cells of the local chunks into the files.
+         */
+        void exportWindow();
+
+        /**
+         * Write <prefix>.json. Only called once every instance exported its chunks.
+         */
+        void writeDescription() const;
+
+    private:
+        /**
+         * A run of cells of one chunk that are kept and consecutive in both the payload and the buffers.
+         */
+        struct Run
+        {
+            position_t pPosition;   // the position of the first cell in the payload
+            uint64_t index;         // the linear index of the first cell in the buffers
+            uint64_t length;
+        };
+
+        /**
+         * A mapped file.
+         */
+        struct Buffer
+        {
+            std::string path;
+            char* data;
+            size_t size;
+        };
+
+        /**
+         * Row-major linear index of pos inside the window box.
+         */
+        uint64_t getIndex(Coordinates const& pos) const;
+
+        /**
+         * Check that the files fit in the address space and on the file system of prefix.
+         */
+        void checkSize() const;
+
+        /**
+         * The runs of the cells of chunk that lie in the window, without the overlap, and, unless kept
+         * is null, whose bit is set in kept.
+         */
+        void getRuns(ConstChunk const& chunk, BCBetweenMask const* kept, std::vector<Run>& runs) const;
+
+        /**
+         * Copy the values of the runs from the payload of chunk into the buffer of attr.
+         */
+        void copyRuns(ConstChunk const& chunk, AttributeDesc const& attr, std::vector<Run> const& runs);
+
+        static void setBits(char* data, uint64_t index, uint64_t length);
+
+        /**
+         * Map the file at path with the given size, creating or growing it if needed.
+         */
+        static Buffer mapFile(std::string const& path, size_t size);
+        static void unmapFile(Buffer& buffer);
+
+        /**
+         * The numpy dtype string of a fixed-size SciDB type.
+         */
+        static std::string getDType(Type const& type);
+
+        std::shared_ptr<BCBetweenArray> _array;
+        Coordinates _lowPos;
+        Coordinates _highPos;
+        std::vector<uint64_t> _strides;
+        uint64_t _volume;
+        std::string _prefix;
+        std::string _filePrefix;    // <prefix>.<query>
+        std::vector<Buffer> _data;  // by attribute
+        std::vector<Buffer> _nulls; // by attribute, for the nullable ones
+        Buffer _mask;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_EXPORT_H_ */
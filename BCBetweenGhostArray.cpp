@@ -0,0 +1,315 @@
+/*
+ * BCBetweenGhostArray.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenGhostArray.h"
+#include <query/Expression.h>
+#include <system/Exceptions.h>
+#include <algorithm>
+#include <map>
+
+namespace scidb
+{
+    BCBetweenGhostArray::BCBetweenGhostArray(ArrayDesc const& desc,
+                                             std::shared_ptr<Array> const& between,
+                                             std::shared_ptr<Array> const& input,
+                                             Coordinates const& lowPos,
+                                             Coordinates const& highPos,
+                                             Coordinates const& innerLowPos,
+                                             Coordinates const& innerHighPos,
+                                             std::shared_ptr<Expression> expr,
+                                             BCBetweenSettings::GhostMode mode,
+                                             std::shared_ptr<Query>& query)
+            : MemArray(desc, query),
+              _between(between),
+              _input(input),
+              _lowPos(lowPos),
+              _highPos(highPos),
+              _innerLowPos(innerLowPos),
+              _innerHighPos(innerHighPos),
+              _expression(expr),
+              _bindings(expr->getBindings()),
+              _mode(mode)
+    {
+        if (!isDominatedBy(lowPos, highPos))
+        {
+            return;
+        }
+
+        SpatialRangesPtr windowPtr = make_shared<SpatialRanges>(lowPos.size());
+        windowPtr->insert(SpatialRange(lowPos, highPos));
+        windowPtr->buildIndex();
+
+        Dimensions const& dims = desc.getDimensions();
+        size_t nDims = dims.size();
+        Attributes const& attrs = desc.getAttributes();
+
+        SpatialRangesChunkPosIterator chunkPosIterator(windowPtr, desc);
+        Coordinates chunkEnd(nDims);
+        for (; !chunkPosIterator.end(); ++chunkPosIterator)
+        {
+            Coordinates const& chunkPos = chunkPosIterator.getPosition();
+            for (size_t d = 0; d < nDims; d++)
+            {
+                chunkEnd[d] = std::min(chunkPos[d] + dims[d].getChunkInterval() - 1, highPos[d]);
+            }
+
+            // The output has no overlap, so a chunk inside the bounds is copied cell by cell too.
+            // The ghost cells of a chunk reaching beyond the bounds are read and checked once for all attributes.
+            std::vector<GhostCell> cells;
+            if (!isInBounds(chunkPos) || !isInBounds(chunkEnd))
+            {
+                getGhostCells(chunkPos, cells);
+                readGhostValues(cells);
+                checkGhostCells(cells);
+            }
+            for (size_t i = 0, n = attrs.size(); i < n; i++)
+            {
+                writeGhostChunk(chunkPos, attrs[i].getId(), cells, query);
+            }
+        }
+    }
+
+    bool BCBetweenGhostArray::isInBounds(Coordinates const& pos) const
+    {
+        Dimensions const& dims = _input->getArrayDesc().getDimensions();
+        for (size_t d = 0, n = pos.size(); d < n; d++)
+        {
+            if (pos[d] < dims[d].getStartMin() || pos[d] > dims[d].getEndMax())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Coordinate BCBetweenGhostArray::getSource(Coordinate pos, size_t dim) const
+    {
+        DimensionDesc const& dimDesc = _input->getArrayDesc().getDimensions()[dim];
+        Coordinate start = dimDesc.getStartMin();
+        Coordinate length = dimDesc.getEndMax() - start + 1;
+        if (pos >= start && pos < start + length)
+        {
+            return pos;
+        }
+
+        if (_mode == BCBetweenSettings::GHOST_PERIODIC)
+        {
+            return start + ((pos - start) % length + length) % length;
+        }
+
+        // Mirror with period 2 * length: start - 1 reads start, end + 1 reads end.
+        Coordinate r = ((pos - start) % (length * 2) + length * 2) % (length * 2);
+        return r < length ? start + r : start + length * 2 - 1 - r;
+    }
+
+    bool BCBetweenGhostArray::isInner(Coordinates const& pos) const
+    {
+        for (size_t d = 0, n = pos.size(); d < n; d++)
+        {
+            if (pos[d] < _innerLowPos[d] || pos[d] > _innerHighPos[d])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void BCBetweenGhostArray::getGhostCells(Coordinates const& chunkPos, std::vector<GhostCell>& cells) const
+    {
+        Dimensions const& dims = getArrayDesc().getDimensions();
+        size_t nDims = dims.size();
+        size_t nInputAttrs = _input->getArrayDesc().getAttributes().size();
+
+        // The part of the window in this chunk.
+        Coordinates low(nDims), high(nDims);
+        for (size_t d = 0; d < nDims; d++)
+        {
+            low[d] = std::max(chunkPos[d], _lowPos[d]);
+            high[d] = std::min(chunkPos[d] + dims[d].getChunkInterval() - 1, _highPos[d]);
+        }
+
+        // Enumerate its ghost cells in row-major order.
+        Coordinates pos = low;
+        while (true)
+        {
+            if (!isInBounds(pos))
+            {
+                GhostCell cell;
+                cell.pos = pos;
+                cell.source.resize(nDims);
+                for (size_t d = 0; d < nDims; d++)
+                {
+                    cell.source[d] = getSource(pos[d], d);
+                }
+                cell.values.resize(nInputAttrs);
+                cell.present = false;
+                cell.kept = false;
+                cells.push_back(cell);
+            }
+
+            size_t d = nDims;
+            while (d-- > 0)
+            {
+                if (++pos[d] <= high[d])
+                {
+                    break;
+                }
+                pos[d] = low[d];
+            }
+            if (d == static_cast<size_t>(-1))
+            {
+                break;
+            }
+        }
+    }
+
+    void BCBetweenGhostArray::readGhostValues(std::vector<GhostCell>& cells)
+    {
+        // Group the cells by source chunk, so that each source chunk is fetched once per attribute.
+        std::map<Coordinates, std::vector<size_t>, CoordinatesLess> bySourceChunk;
+        for (size_t k = 0, n = cells.size(); k < n; k++)
+        {
+            Coordinates chunkPos = cells[k].source;
+            _input->getArrayDesc().getChunkPositionFor(chunkPos);
+            bySourceChunk[chunkPos].push_back(k);
+        }
+
+        Attributes const& inputAttrs = _input->getArrayDesc().getAttributes();
+        for (size_t a = 0, nAttrs = inputAttrs.size(); a < nAttrs && !cells.empty(); a++)
+        {
+            std::shared_ptr<ConstArrayIterator> sourceIterator = _input->getConstIterator(inputAttrs[a].getId());
+            std::map<Coordinates, std::vector<size_t>, CoordinatesLess>::const_iterator group;
+            for (group = bySourceChunk.begin(); group != bySourceChunk.end(); ++group)
+            {
+                // Source chunks of other instances fill their ghost cells there.
+                if (!sourceIterator->setPosition(group->first))
+                {
+                    continue;
+                }
+                std::shared_ptr<ConstChunkIterator> it = sourceIterator->getChunk().getConstIterator(
+                        ConstChunkIterator::IGNORE_EMPTY_CELLS);
+                for (size_t j = 0, m = group->second.size(); j < m; j++)
+                {
+                    GhostCell& cell = cells[group->second[j]];
+                    if (it->setPosition(cell.source))
+                    {
+                        cell.values[a] = it->getItem();
+                        cell.present = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void BCBetweenGhostArray::checkGhostCells(std::vector<GhostCell>& cells) const
+    {
+        ExpressionContext params(*_expression);
+        for (size_t i = 0, n = _bindings.size(); i < n; i++)
+        {
+            if (_bindings[i].kind == BindInfo::BI_VALUE)
+            {
+                params[i] = _bindings[i].value;
+            }
+        }
+
+        // Like every other shell cell, a ghost cell in the shell is kept when the boundary expression passes
+        // on its value; its coordinates are its own, beyond the bounds.
+        for (size_t k = 0, n = cells.size(); k < n; k++)
+        {
+            GhostCell& cell = cells[k];
+            if (!cell.present || isInner(cell.pos))
+            {
+                cell.kept = cell.present;
+                continue;
+            }
+            for (size_t i = 0, nBindings = _bindings.size(); i < nBindings; i++)
+            {
+                switch (_bindings[i].kind)
+                {
+                    case BindInfo::BI_ATTRIBUTE:
+                    {
+                        params[i] = cell.values[_bindings[i].resolvedId];
+                        break;
+                    }
+                    case BindInfo::BI_COORDINATE:
+                    {
+                        params[i].setInt64(cell.pos[_bindings[i].resolvedId]);
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+            Value const& result = _expression->evaluate(params);
+            cell.kept = !result.isNull() && result.getBool();
+        }
+    }
+
+    void BCBetweenGhostArray::writeGhostChunk(Coordinates const& chunkPos, AttributeID attrID,
+                                              std::vector<GhostCell> const& cells,
+                                              std::shared_ptr<Query> const& query)
+    {
+        ArrayDesc const& inputDesc = _input->getArrayDesc();
+        AttributeDesc const& attr = getArrayDesc().getAttributes()[attrID];
+
+        // A new output empty tag is set on every kept cell.
+        bool isNewEmptyTag = attrID >= inputDesc.getAttributes().size();
+
+        Value trueValue(TypeLibrary::getType(TID_BOOL));
+        trueValue.setBool(true);
+
+        std::shared_ptr<ConstChunkIterator> betweenIterator;
+        std::shared_ptr<ConstArrayIterator> betweenArrayIterator = _between->getConstIterator(attrID);
+        if (betweenArrayIterator->setPosition(chunkPos))
+        {
+            betweenIterator = betweenArrayIterator->getChunk().getConstIterator(
+                    ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+        }
+
+        // Merge the two row-major streams.
+        std::shared_ptr<ChunkIterator> outIterator;
+        int mode = ChunkIterator::SEQUENTIAL_WRITE;
+        if (!attr.isEmptyIndicator())
+        {
+            mode |= ChunkIterator::NO_EMPTY_CHECK;
+        }
+        CoordinatesLess less;
+        size_t k = 0;
+        while (true)
+        {
+            while (k < cells.size() && !cells[k].kept)
+            {
+                k++;
+            }
+            bool hasGhost = k < cells.size();
+            bool hasBetween = betweenIterator && !betweenIterator->end();
+            if (!hasGhost && !hasBetween)
+            {
+                break;
+            }
+            if (!outIterator)
+            {
+                outIterator = getIterator(attrID)->newChunk(chunkPos).getIterator(query, mode);
+            }
+
+            if (hasGhost && (!hasBetween || less(cells[k].pos, betweenIterator->getPosition())))
+            {
+                outIterator->setPosition(cells[k].pos);
+                outIterator->writeItem(isNewEmptyTag ? trueValue : cells[k].values[attrID]);
+                k++;
+            } else
+            {
+                outIterator->setPosition(betweenIterator->getPosition());
+                outIterator->writeItem(betweenIterator->getItem());
+                ++(*betweenIterator);
+            }
+        }
+        if (outIterator)
+        {
+            outIterator->flush();
+        }
+    }
+}
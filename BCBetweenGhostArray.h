@@ -0,0 +1,111 @@
+/*
+ * BCBetweenGhostArray.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenGhostArray.h
+ *
+ * @brief Ghost cells for the bc_between window.
+ *
+ * In ghost mode, the window is not clamped to the array bounds. The output schema is widened by
+ * whole chunks so that the window fits and the chunk grid stays aligned with the input, and has no
+ * chunk overlap. Chunks of the window inside the array are copied from the BCBetweenArray, without
+ * the overlap of the input. Chunks reaching beyond the bounds
+ * merge the BCBetweenArray cells with ghost cells, whose values are read directly from the wrapped
+ * or mirrored source chunks of the input; no intermediate array is built. A ghost cell in the shell of
+ * the window is kept only when the boundary expression passes on its values, as any other shell cell.
+ *
+ * Every instance fills the ghost cells whose source chunk it holds, so a ghost chunk may be built
+ * in pieces on several instances. The output distribution is therefore undefined.
+ */
+
+#ifndef BC_BETWEEN_GHOST_ARRAY_H_
+#define BC_BETWEEN_GHOST_ARRAY_H_
+
+#include <array/MemArray.h>
+#include <query/Operator.h>
+#include <vector>
+#include "BCBetweenArray.h"
+
+namespace scidb
+{
+    class BCBetweenGhostArray : public MemArray
+    {
+    public:
+        /**
+         * @param desc the widened output schema.
+         * @param between the BCBetweenArray over the part of the window inside the array.
+         * @param input the input array; must support random access.
+         * @param lowPos the low coordinates of the window, possibly beyond the array bounds.
+         * @param highPos the high coordinates of the window, possibly beyond the array bounds.
+         * @param innerLowPos the low coordinates of the inner window.
+         * @param innerHighPos the high coordinates of the inner window.
+         * @param expr the boundary expression, checked on the ghost cells in the shell.
+         * @param mode how the ghost cells are filled.
+         */
+        BCBetweenGhostArray(ArrayDesc const& desc,
+                            std::shared_ptr<Array> const& between,
+                            std::shared_ptr<Array> const& input,
+                            Coordinates const& lowPos,
+                            Coordinates const& highPos,
+                            Coordinates const& innerLowPos,
+                            Coordinates const& innerHighPos,
+                            std::shared_ptr<Expression> expr,
+                            BCBetweenSettings::GhostMode mode,
+                            std::shared_ptr<Query>& query);
+
+    private:
+        struct GhostCell
+        {
+            Coordinates pos;
+            Coordinates source;
+            std::vector<Value> values; // by input attribute
+            bool present;
+            bool kept;                 // present, and inside the inner window or passing the boundary check
+        };
+
+        bool isInBounds(Coordinates const& pos) const;
+        bool isInner(Coordinates const& pos) const;
+
+        /**
+         * The coordinate inside the array whose cell fills the ghost coordinate pos on dimension dim.
+         */
+        Coordinate getSource(Coordinate pos, size_t dim) const;
+
+        /**
+         * The ghost cells of the window in the chunk at chunkPos, in row-major order.
+         */
+        void getGhostCells(Coordinates const& chunkPos, std::vector<GhostCell>& cells) const;
+
+        /**
+         * Read the ghost values of every input attribute, visiting every source chunk once per attribute.
+         */
+        void readGhostValues(std::vector<GhostCell>& cells);
+
+        /**
+         * Decide which ghost cells are kept, evaluating the boundary expression on the ones in the shell.
+         */
+        void checkGhostCells(std::vector<GhostCell>& cells) const;
+
+        /**
+         * Build the chunk at chunkPos by merging the BCBetweenArray cells and the kept ghost cells,
+         * in row-major order.
+         */
+        void writeGhostChunk(Coordinates const& chunkPos, AttributeID attrID, std::vector<GhostCell> const& cells,
+                             std::shared_ptr<Query> const& query);
+
+        std::shared_ptr<Array> _between;
+        std::shared_ptr<Array> _input;
+        Coordinates _lowPos;
+        Coordinates _highPos;
+        Coordinates _innerLowPos;
+        Coordinates _innerHighPos;
+        std::shared_ptr<Expression> _expression;
+        std::vector<BindInfo> _bindings;
+        BCBetweenSettings::GhostMode _mode;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_GHOST_ARRAY_H_ */
@@ -0,0 +1,160 @@
+/*
+ * BCBetweenMaskCache.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenMaskCache.h"
+#include <system/Exceptions.h>
+#include <MurmurHash/MurmurHash3.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+
+namespace scidb
+{
+    BCBetweenMaskCache::BCBetweenMaskCache(std::string const& dir, std::string const& key)
+            : _dir(dir + "/" + hash(key))
+    {
+        if ((::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) ||
+            (::mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST))
+        {
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_CANT_OPEN_FILE) << _dir << ::strerror(errno) << errno;
+        }
+    }
+
+    BCBetweenMaskCache::Hasher::Hasher()
+            : h1(BIG_CONSTANT(0x87c37b91114253d5)),
+              h2(BIG_CONSTANT(0x4cf5ad432745937f)),
+              length(0)
+    {
+    }
+
+    void BCBetweenMaskCache::Hasher::add(void const* data, size_t size)
+    {
+        // Two fmix chains with different seeds over the 8-byte words of the data.
+        char const* bytes = static_cast<char const*>(data);
+        for (size_t i = 0; i < size; i += 8)
+        {
+            uint64_t word = 0;
+            memcpy(&word, bytes + i, std::min<size_t>(8, size - i));
+            h1 = fmix(h1 ^ word) + length + i;
+            h2 = fmix(h2 + word) ^ h1;
+        }
+        length += size;
+    }
+
+    std::string BCBetweenMaskCache::Hasher::finish() const
+    {
+        uint64_t f1 = fmix(h1 ^ length);
+        uint64_t f2 = fmix(h2 ^ f1);
+
+        char buffer[33];
+        snprintf(buffer, sizeof(buffer), "%016llx%016llx", (unsigned long long)f1, (unsigned long long)f2);
+        return buffer;
+    }
+
+    std::string BCBetweenMaskCache::hash(std::string const& text)
+    {
+        Hasher hasher;
+        hasher.add(text.data(), text.size());
+        return hasher.finish();
+    }
+
+    std::string BCBetweenMaskCache::getPath(Coordinates const& chunkPos) const
+    {
+        std::ostringstream oss;
+        oss << _dir << "/";
+        for (size_t i = 0, n = chunkPos.size(); i < n; i++)
+        {
+            oss << (i ? "_" : "") << chunkPos[i];
+        }
+        oss << ".mask";
+        return oss.str();
+    }
+
+    void BCBetweenMaskCache::remember(Coordinates const& chunkPos, std::shared_ptr<BCBetweenMask const> const& mask)
+    {
+        if (_masks.insert(std::make_pair(chunkPos, mask)).second)
+        {
+            _order.push_back(chunkPos);
+        }
+        while (_order.size() > MAX_MASKS_IN_MEMORY)
+        {
+            _masks.erase(_order.front());
+            _order.pop_front();
+        }
+    }
+
+    std::shared_ptr<BCBetweenMask const> BCBetweenMaskCache::find(Coordinates const& chunkPos)
+    {
+        ScopedMutexLock cs(_mutex);
+        std::map<Coordinates, std::shared_ptr<BCBetweenMask const>, CoordinatesLess>::const_iterator it = _masks.find(chunkPos);
+        return it != _masks.end() ? it->second : std::shared_ptr<BCBetweenMask const>();
+    }
+
+    std::shared_ptr<BCBetweenMask const> BCBetweenMaskCache::load(Coordinates const& chunkPos, size_t nBits, std::string const& digest)
+    {
+        std::ifstream in(getPath(chunkPos).c_str(), std::ios::binary);
+        if (!in)
+        {
+            return std::shared_ptr<BCBetweenMask const>();
+        }
+
+        // The file starts with the digest of the input chunks the mask was computed from.
+        std::string stored(digest.size(), '\0');
+        in.read(&stored[0], stored.size());
+        if (in.gcount() != static_cast<std::streamsize>(stored.size()) || stored != digest)
+        {
+            return std::shared_ptr<BCBetweenMask const>();
+        }
+
+        std::shared_ptr<BCBetweenMask> mask = std::make_shared<BCBetweenMask>((nBits + 7) / 8);
+        in.read(reinterpret_cast<char*>(&(*mask)[0]), mask->size());
+
+        // A mask of another size, or a truncated one, is computed again.
+        if (in.gcount() != static_cast<std::streamsize>(mask->size()) || in.peek() != EOF)
+        {
+            return std::shared_ptr<BCBetweenMask const>();
+        }
+
+        ScopedMutexLock cs(_mutex);
+        remember(chunkPos, mask);
+        return mask;
+    }
+
+    void BCBetweenMaskCache::put(Coordinates const& chunkPos, std::string const& digest, std::shared_ptr<BCBetweenMask const> const& mask)
+    {
+        {
+            ScopedMutexLock cs(_mutex);
+            remember(chunkPos, mask);
+        }
+
+        // Write to a file of this process, then rename, so that a reader never sees a partial mask.
+        // A mask of an older version of the chunk is replaced.
+        std::string path = getPath(chunkPos);
+        std::ostringstream tmp;
+        tmp << path << "." << ::getpid() << "." << pthread_self();
+        {
+            std::ofstream out(tmp.str().c_str(), std::ios::binary | std::ios::trunc);
+            out.write(digest.data(), digest.size());
+            out.write(reinterpret_cast<char const*>(&(*mask)[0]), mask->size());
+            if (!out)
+            {
+                // The cache is an optimization; failing to store a mask is not an error.
+                ::unlink(tmp.str().c_str());
+                return;
+            }
+        }
+        if (::rename(tmp.str().c_str(), path.c_str()) != 0)
+        {
+            ::unlink(tmp.str().c_str());
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * BCBetweenMaskCache.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenMaskCache.h
+ *
+ * @brief Persistent cache of the shell masks of bc_between.
+ *
+ * A shell mask holds one bit per logical position of an input chunk, overlap included, in the
+ * row-major order of the chunk. A bit is set when the boundary expression passes at that position.
+ * Only the shell positions are meaningful.
+ *
+ * The masks are stored on the local disk of every instance, in <cache_dir>/<key>/<chunk position>.mask,
+ * where the key is a hash of the input array ID, the window and inner window, the neighbor bindings and
+ * the text of the boundary expression. Every mask is stored with a digest of the identity of the stored
+ * input chunks it was computed from, so after a new version of the array, only the masks of the chunks
+ * the new version wrote again are computed again. Masks of the running query are also kept in memory, so that every
+ * attribute of a chunk shares them.
+ */
+
+#ifndef BC_BETWEEN_MASK_CACHE_H_
+#define BC_BETWEEN_MASK_CACHE_H_
+
+#include <array/Metadata.h>
+#include <util/Mutex.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace scidb
+{
+    typedef std::vector<uint8_t> BCBetweenMask;
+
+    class BCBetweenMaskCache
+    {
+    public:
+        /**
+         * @param dir the cache directory, shared by all keys.
+         * @param key the text identifying the input array, the window and the expression.
+         */
+        BCBetweenMaskCache(std::string const& dir, std::string const& key);
+
+        /**
+         * The mask of the chunk at chunkPos computed in the running query, or null.
+         */
+        std::shared_ptr<BCBetweenMask const> find(Coordinates const& chunkPos);
+
+        /**
+         * The stored mask of the chunk at chunkPos, or null if it was never computed,
+         * or computed from other input chunks.
+         * @param nBits the number of logical positions of the chunk, overlap included.
+         * @param digest the digest of the input chunks the mask is computed from.
+         */
+        std::shared_ptr<BCBetweenMask const> load(Coordinates const& chunkPos, size_t nBits, std::string const& digest);
+
+        void put(Coordinates const& chunkPos, std::string const& digest, std::shared_ptr<BCBetweenMask const> const& mask);
+
+        static bool test(BCBetweenMask const& mask, position_t pos)
+        {
+            return (mask[pos >> 3] >> (pos & 7)) & 1;
+        }
+
+        static void set(BCBetweenMask& mask, position_t pos)
+        {
+            mask[pos >> 3] |= static_cast<uint8_t>(1 << (pos & 7));
+        }
+
+        /**
+         * A 128-bit hash of text, as 32 hexadecimal digits.
+         */
+        static std::string hash(std::string const& text);
+
+        /**
+         * Incremental form of hash(): add() every piece, then finish().
+         */
+        struct Hasher
+        {
+            uint64_t h1;
+            uint64_t h2;
+            uint64_t length;
+
+            Hasher();
+            void add(void const* data, size_t size);
+            std::string finish() const;
+        };
+
+    private:
+        std::string getPath(Coordinates const& chunkPos) const;
+        void remember(Coordinates const& chunkPos, std::shared_ptr<BCBetweenMask const> const& mask);
+
+        /**
+         * At most this many masks are kept in memory; the oldest one is dropped first.
+         */
+        static const size_t MAX_MASKS_IN_MEMORY = 64;
+
+        std::string _dir;
+        std::map<Coordinates, std::shared_ptr<BCBetweenMask const>, CoordinatesLess> _masks;
+        std::deque<Coordinates> _order;
+        Mutex _mutex;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_MASK_CACHE_H_ */
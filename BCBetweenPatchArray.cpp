@@ -0,0 +1,297 @@
+/*
+ * BCBetweenPatchArray.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenPatchArray.h"
+#include <system/Exceptions.h>
+#include <algorithm>
+
+namespace scidb
+{
+    BCBetweenPatchArray::BCBetweenPatchArray(ArrayDesc const& desc,
+                                             std::shared_ptr<Array> const& input,
+                                             Coordinates const& lowPos,
+                                             Coordinates const& highPos,
+                                             Coordinates const& stride,
+                                             int64_t nPatches,
+                                             Coordinates const& shellLow,
+                                             Coordinates const& shellHigh,
+                                             std::shared_ptr<Expression> expr,
+                                             std::shared_ptr<Query>& query)
+            : MemArray(desc, query),
+              _input(input),
+              _lowPos(lowPos),
+              _highPos(highPos),
+              _stride(stride),
+              _nPatches(nPatches),
+              _innerLow(nPatches),
+              _innerHigh(nPatches),
+              _expression(expr),
+              _bindings(expr->getBindings()),
+              _bindingIterators(_bindings.size())
+    {
+        ArrayDesc const& inputDesc = input->getArrayDesc();
+        Dimensions const& dims = inputDesc.getDimensions();
+        size_t nDims = dims.size();
+
+        // The window of every patch, clamped like PhysicalBCBetween::getWindowStart/End,
+        // and its inner window shrunk by the shell widths.
+        SpatialRangesPtr windowsPtr = make_shared<SpatialRanges>(nDims);
+        for (int64_t p = 0; p < nPatches; p++)
+        {
+            Coordinates low(nDims), high(nDims);
+            _innerLow[p].resize(nDims);
+            _innerHigh[p].resize(nDims);
+            for (size_t d = 0; d < nDims; d++)
+            {
+                low[d] = std::max(lowPos[d] + p * stride[d], dims[d].getStartMin());
+                high[d] = std::min(highPos[d] + p * stride[d], dims[d].getEndMax());
+                _innerLow[p][d] = low[d] + shellLow[d];
+                _innerHigh[p][d] = high[d] - shellHigh[d];
+            }
+            if (isDominatedBy(low, high))
+            {
+                windowsPtr->insert(SpatialRange(low, high));
+            }
+        }
+        if (windowsPtr->ranges().empty())
+        {
+            return;
+        }
+        windowsPtr->buildIndex();
+
+        for (size_t i = 0, n = _bindings.size(); i < n; i++)
+        {
+            if (_bindings[i].kind == BindInfo::BI_ATTRIBUTE)
+            {
+                _bindingIterators[i] = input->getConstIterator(safe_static_cast<AttributeID>(_bindings[i].resolvedId));
+            }
+        }
+
+        Attributes const& outAttrs = desc.getAttributes();
+        Attributes const& inAttrs = inputDesc.getAttributes();
+        _inputIterators.resize(outAttrs.size());
+        for (size_t i = 0, n = outAttrs.size(); i < n; i++)
+        {
+            if (!outAttrs[i].isEmptyIndicator())
+            {
+                _inputIterators[i] = input->getConstIterator(outAttrs[i].getId());
+            }
+        }
+
+        // The driver decides which chunks exist: the input empty tag if there is one, else the first attribute.
+        AttributeDesc const* inputEmptyTag = inputDesc.getEmptyBitmapAttribute();
+        std::shared_ptr<ConstArrayIterator> driver =
+                input->getConstIterator(inputEmptyTag ? inputEmptyTag->getId() : inAttrs[0].getId());
+
+        SpatialRangesChunkPosIterator chunkPosIterator(windowsPtr, inputDesc);
+        while (!chunkPosIterator.end())
+        {
+            Coordinates const& chunkPos = chunkPosIterator.getPosition();
+            if (driver->setPosition(chunkPos))
+            {
+                for (size_t i = 0, n = _bindingIterators.size(); i < n; i++)
+                {
+                    if (_bindingIterators[i] && !_bindingIterators[i]->setPosition(chunkPos))
+                        throw USER_EXCEPTION(SCIDB_SE_EXECUTION, SCIDB_LE_OPERATION_FAILED) << "setPosition";
+                }
+                for (size_t i = 0, n = _inputIterators.size(); i < n; i++)
+                {
+                    if (_inputIterators[i] && !_inputIterators[i]->setPosition(chunkPos))
+                        throw USER_EXCEPTION(SCIDB_SE_EXECUTION, SCIDB_LE_OPERATION_FAILED) << "setPosition";
+                }
+
+                classifyChunk(chunkPos);
+                for (size_t i = 0, n = outAttrs.size(); i < n; i++)
+                {
+                    writeChunk(chunkPos, outAttrs[i].getId(), query);
+                }
+            }
+            ++chunkPosIterator;
+        }
+    }
+
+    void BCBetweenPatchArray::getPatchRange(Coordinates const& pos, int64_t& firstPatch, int64_t& lastPatch) const
+    {
+        firstPatch = 0;
+        lastPatch = _nPatches - 1;
+        for (size_t d = 0, n = pos.size(); d < n && firstPatch <= lastPatch; d++)
+        {
+            if (_stride[d] == 0)
+            {
+                if (pos[d] < _lowPos[d] || pos[d] > _highPos[d])
+                {
+                    lastPatch = -1;
+                }
+                continue;
+            }
+
+            // low + p * stride <= pos <= high + p * stride
+            int64_t fromHigh = pos[d] - _highPos[d];
+            int64_t fromLow = pos[d] - _lowPos[d];
+            int64_t first = fromHigh > 0 ? (fromHigh + _stride[d] - 1) / _stride[d] : -((-fromHigh) / _stride[d]);
+            int64_t last = fromLow >= 0 ? fromLow / _stride[d] : -((-fromLow + _stride[d] - 1) / _stride[d]);
+            firstPatch = std::max(firstPatch, first);
+            lastPatch = std::min(lastPatch, last);
+        }
+    }
+
+    bool BCBetweenPatchArray::isInner(Coordinates const& pos, int64_t patch) const
+    {
+        Coordinates const& low = _innerLow[patch];
+        Coordinates const& high = _innerHigh[patch];
+        for (size_t d = 0, n = pos.size(); d < n; d++)
+        {
+            if (pos[d] < low[d] || pos[d] > high[d])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void BCBetweenPatchArray::classifyChunk(Coordinates const& chunkPos)
+    {
+        _cells.clear();
+
+        ExpressionContext params(*_expression);
+        std::vector<std::shared_ptr<ConstChunkIterator> > iterators(_bindings.size());
+        std::shared_ptr<ConstChunkIterator> cellIterator;
+        for (size_t i = 0, n = _bindings.size(); i < n; i++)
+        {
+            switch (_bindings[i].kind)
+            {
+                case BindInfo::BI_ATTRIBUTE:
+                {
+                    iterators[i] = _bindingIterators[i]->getChunk().getConstIterator(
+                            ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+                    cellIterator = iterators[i];
+                    break;
+                }
+                case BindInfo::BI_VALUE:
+                {
+                    params[i] = _bindings[i].value;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        if (!cellIterator)
+        {
+            // The expression binds no attribute. Walk any attribute to get the cell positions.
+            cellIterator = _inputIterators[0]->getChunk().getConstIterator(
+                    ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+        }
+
+        while (!cellIterator->end())
+        {
+            Coordinates const& pos = cellIterator->getPosition();
+            CellInfo info;
+            getPatchRange(pos, info.firstPatch, info.lastPatch);
+            info.passed = false;
+
+            bool inShell = false;
+            for (int64_t p = info.firstPatch; p <= info.lastPatch && !inShell; p++)
+            {
+                inShell = !isInner(pos, p);
+            }
+            if (inShell)
+            {
+                for (size_t i = 0, n = _bindings.size(); i < n; i++)
+                {
+                    switch (_bindings[i].kind)
+                    {
+                        case BindInfo::BI_ATTRIBUTE:
+                        {
+                            params[i] = iterators[i]->getItem();
+                            break;
+                        }
+                        case BindInfo::BI_COORDINATE:
+                        {
+                            params[i].setInt64(pos[_bindings[i].resolvedId]);
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                }
+                Value const& result = _expression->evaluate(params);
+                info.passed = !result.isNull() && result.getBool();
+            }
+            _cells.push_back(info);
+
+            for (size_t i = 0, n = iterators.size(); i < n; i++)
+            {
+                if (iterators[i] && iterators[i] != cellIterator)
+                {
+                    ++(*iterators[i]);
+                }
+            }
+            ++(*cellIterator);
+        }
+    }
+
+    void BCBetweenPatchArray::writeChunk(Coordinates const& chunkPos, AttributeID attrID, std::shared_ptr<Query> const& query)
+    {
+        AttributeDesc const& attr = getArrayDesc().getAttributes()[attrID];
+        std::shared_ptr<ConstChunkIterator> inputIterator;
+        if (_inputIterators[attrID])
+        {
+            inputIterator = _inputIterators[attrID]->getChunk().getConstIterator(
+                    ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+        } else
+        {
+            // The output empty tag; walk any input attribute for the positions.
+            inputIterator = _inputIterators[0]->getChunk().getConstIterator(
+                    ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS);
+        }
+
+        Value trueValue(TypeLibrary::getType(TID_BOOL));
+        trueValue.setBool(true);
+
+        Coordinates outChunkPos(chunkPos);
+        outChunkPos.push_back(0);
+        Coordinates outPos(outChunkPos);
+        int mode = ChunkIterator::SEQUENTIAL_WRITE;
+        if (!attr.isEmptyIndicator())
+        {
+            mode |= ChunkIterator::NO_EMPTY_CHECK;
+        }
+
+        // The output chunk is created with its first kept cell, so a chunk that keeps none is not written.
+        std::shared_ptr<ChunkIterator> outIterator;
+        size_t nDims = chunkPos.size();
+        for (size_t k = 0; !inputIterator->end(); ++(*inputIterator), k++)
+        {
+            CellInfo const& info = _cells[k];
+            if (info.firstPatch > info.lastPatch)
+            {
+                continue;
+            }
+
+            Coordinates const& pos = inputIterator->getPosition();
+            for (int64_t p = info.firstPatch; p <= info.lastPatch; p++)
+            {
+                if (!isKept(pos, p, info))
+                {
+                    continue;
+                }
+                std::copy(pos.begin(), pos.end(), outPos.begin());
+                outPos[nDims] = p;
+                if (!outIterator)
+                {
+                    outIterator = getIterator(attrID)->newChunk(outChunkPos).getIterator(query, mode);
+                }
+                outIterator->setPosition(outPos);
+                outIterator->writeItem(attr.isEmptyIndicator() ? trueValue : inputIterator->getItem());
+            }
+        }
+        if (outIterator)
+        {
+            outIterator->flush();
+        }
+    }
+}
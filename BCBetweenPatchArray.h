@@ -0,0 +1,110 @@
+/*
+ * BCBetweenPatchArray.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenPatchArray.h
+ *
+ * @brief The sliding-window batch mode of the bc_between operator.
+ *
+ * Patch p covers the window [low + p * stride, high + p * stride], clamped to the array bounds,
+ * and applies the same boundary check as a single bc_between over that window.
+ *
+ * Instead of running one bc_between per patch, the patch array visits every input chunk that
+ * overlaps any patch exactly once. The chunk is decoded once, the boundary expression is
+ * evaluated at most once per cell, and the cell is written once for every patch that keeps it.
+ * The patch index is the trailing output dimension and spans a single chunk, so all patches
+ * of an input chunk land in the same output chunk and are written in one sequential pass.
+ */
+
+#ifndef BC_BETWEEN_PATCH_ARRAY_H_
+#define BC_BETWEEN_PATCH_ARRAY_H_
+
+#include <array/MemArray.h>
+#include <query/Operator.h>
+#include <vector>
+#include "BCBetweenArray.h"
+
+namespace scidb
+{
+    class BCBetweenPatchArray : public MemArray
+    {
+    public:
+        /**
+         * Materialize all patches.
+         * @param desc the output schema, with the trailing patch dimension.
+         * @param input the input array; must support random access.
+         * @param lowPos the unclamped low coordinates of the first patch.
+         * @param highPos the unclamped high coordinates of the first patch.
+         * @param stride the shift between consecutive patches.
+         * @param nPatches the number of patches.
+         * @param shellLow the shell thickness on the low side of every dimension.
+         * @param shellHigh the shell thickness on the high side of every dimension.
+         */
+        BCBetweenPatchArray(ArrayDesc const& desc,
+                            std::shared_ptr<Array> const& input,
+                            Coordinates const& lowPos,
+                            Coordinates const& highPos,
+                            Coordinates const& stride,
+                            int64_t nPatches,
+                            Coordinates const& shellLow,
+                            Coordinates const& shellHigh,
+                            std::shared_ptr<Expression> expr,
+                            std::shared_ptr<Query>& query);
+
+    private:
+        /**
+         * What the patch array remembers about one input cell between the
+         * evaluation pass and the write passes.
+         */
+        struct CellInfo
+        {
+            int64_t firstPatch;
+            int64_t lastPatch;  // firstPatch > lastPatch if the cell is in no patch.
+            bool passed;        // the boundary expression result, if it was needed.
+        };
+
+        /**
+         * Compute the range of patches containing pos. Membership does not depend on the clamping,
+         * because pos always lies inside the array.
+         */
+        void getPatchRange(Coordinates const& pos, int64_t& firstPatch, int64_t& lastPatch) const;
+
+        bool isInner(Coordinates const& pos, int64_t patch) const;
+
+        bool isKept(Coordinates const& pos, int64_t patch, CellInfo const& info) const
+        {
+            return info.passed || isInner(pos, patch);
+        }
+
+        /**
+         * Evaluate the boundary expression for every cell of the chunk at chunkPos that lies in
+         * the shell of some patch.
+         */
+        void classifyChunk(Coordinates const& chunkPos);
+
+        void writeChunk(Coordinates const& chunkPos, AttributeID attrID, std::shared_ptr<Query> const& query);
+
+        std::shared_ptr<Array> _input;
+        Coordinates _lowPos;
+        Coordinates _highPos;
+        Coordinates _stride;
+        int64_t _nPatches;
+
+        /**
+         * The clamped inner window of every patch, concatenated.
+         */
+        std::vector<Coordinates> _innerLow;
+        std::vector<Coordinates> _innerHigh;
+
+        std::shared_ptr<Expression> _expression;
+        std::vector<BindInfo> _bindings;
+        std::vector<std::shared_ptr<ConstArrayIterator> > _bindingIterators;
+        std::vector<std::shared_ptr<ConstArrayIterator> > _inputIterators;
+        std::vector<CellInfo> _cells;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_PATCH_ARRAY_H_ */
@@ -0,0 +1,122 @@
+/*
+ * BCBetweenPrepared.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenPrepared.h"
+#include "BCBetweenArray.h"
+
+namespace scidb
+{
+    Mutex BCBetweenPrepared::_registryMutex;
+    std::map<std::string, std::shared_ptr<BCBetweenPrepared> > BCBetweenPrepared::_registry;
+    std::deque<std::string> BCBetweenPrepared::_registryOrder;
+
+    BCBetweenPrepared::BCBetweenPrepared()
+            : _haloBytes(0)
+    {
+    }
+
+    std::shared_ptr<BCBetweenPrepared> BCBetweenPrepared::get(std::string const& key)
+    {
+        ScopedMutexLock cs(_registryMutex);
+        std::shared_ptr<BCBetweenPrepared>& prepared = _registry[key];
+        if (prepared)
+        {
+            return prepared;
+        }
+
+        // A running query keeps its shape alive after it is dropped from the registry.
+        std::shared_ptr<BCBetweenPrepared> result = std::make_shared<BCBetweenPrepared>();
+        prepared = result;
+        _registryOrder.push_back(key);
+        while (_registryOrder.size() > MAX_SHAPES)
+        {
+            _registry.erase(_registryOrder.front());
+            _registryOrder.pop_front();
+        }
+        return result;
+    }
+
+    std::shared_ptr<BCBetweenZoneMap> BCBetweenPrepared::getZoneMap() const
+    {
+        ScopedMutexLock cs(_mutex);
+        return _zoneMap;
+    }
+
+    void BCBetweenPrepared::setZoneMap(std::shared_ptr<BCBetweenZoneMap> const& zoneMap)
+    {
+        ScopedMutexLock cs(_mutex);
+        if (!_zoneMap)
+        {
+            _zoneMap = zoneMap;
+        }
+    }
+
+    std::shared_ptr<std::vector<size_t> const> BCBetweenPrepared::getTermOrder() const
+    {
+        ScopedMutexLock cs(_mutex);
+        return _termOrder;
+    }
+
+    void BCBetweenPrepared::setTermOrder(std::shared_ptr<std::vector<size_t> const> const& order)
+    {
+        ScopedMutexLock cs(_mutex);
+        if (!_termOrder)
+        {
+            _termOrder = order;
+        }
+    }
+
+    std::shared_ptr<BCBetweenPrepared::Scaffold const> BCBetweenPrepared::getScaffold() const
+    {
+        ScopedMutexLock cs(_mutex);
+        return _scaffold;
+    }
+
+    void BCBetweenPrepared::setScaffold(std::shared_ptr<Scaffold const> const& scaffold)
+    {
+        ScopedMutexLock cs(_mutex);
+        if (!_scaffold)
+        {
+            _scaffold = scaffold;
+        }
+    }
+
+    std::shared_ptr<BCBetweenHalo const> BCBetweenPrepared::getHalo(Coordinates const& key) const
+    {
+        ScopedMutexLock cs(_mutex);
+        std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess>::const_iterator it = _halos.find(key);
+        return it == _halos.end() ? std::shared_ptr<BCBetweenHalo const>() : it->second;
+    }
+
+    void BCBetweenPrepared::addHalo(Coordinates const& key, std::shared_ptr<BCBetweenHalo const> const& halo)
+    {
+        ScopedMutexLock cs(_mutex);
+        if (!_halos.insert(std::make_pair(key, halo)).second)
+        {
+            return;
+        }
+        _haloOrder.push_back(key);
+        _haloBytes += getSize(*halo);
+        while (_haloBytes > MAX_HALO_BYTES && _haloOrder.size() > 1)
+        {
+            std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess>::iterator oldest =
+                    _halos.find(_haloOrder.front());
+            _haloBytes -= getSize(*oldest->second);
+            _halos.erase(oldest);
+            _haloOrder.pop_front();
+        }
+    }
+
+    size_t BCBetweenPrepared::getSize(BCBetweenHalo const& halo)
+    {
+        size_t size = sizeof(BCBetweenHalo) + halo.positions.size() * sizeof(position_t);
+        for (size_t i = 0, n = halo.values.size(); i < n; i++)
+        {
+            size += sizeof(Value) + halo.values[i].size();
+        }
+        return size;
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * BCBetweenPrepared.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenPrepared.h
+ *
+ * @brief The state bc_between keeps across the queries of one shape.
+ *
+ * With 'prepared=true', the queries that run the same boundary expression with the same neighbor
+ * bindings on the same version of a stored array, with the same 'cache_dir', share one BCBetweenPrepared
+ * per instance, whatever their windows. The first query builds what does not depend on the window, and
+ * the next ones take it over instead of building it again:
+ *   - the scaffold: the resolved offsets of the neighbor bindings, their halo reach, and the bindings
+ *     of the and/or terms in the expression;
+ *   - the halos, the edge slabs read from the input chunks for the neighbor bindings, up to MAX_HALO_BYTES;
+ *   - the zone map with its synopses;
+ *   - the measured order of the and/or terms.
+ * Each query then only builds its window: the spatial ranges and the chunk positions they cover.
+ * The registry keeps the last MAX_SHAPES shapes of the instance.
+ *
+ * The query itself is still parsed, its expression compiled and its plan built by SciDB each time;
+ * only the work of the operator is saved.
+ */
+
+#ifndef BC_BETWEEN_PREPARED_H_
+#define BC_BETWEEN_PREPARED_H_
+
+#include <array/Metadata.h>
+#include <util/Mutex.h>
+#include "BCBetweenZoneMap.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace scidb
+{
+    struct BCBetweenHalo;
+
+    class BCBetweenPrepared
+    {
+    public:
+        /**
+         * What BCBetweenArray resolves from the expression and the neighbor bindings, whatever the window.
+         */
+        struct Scaffold
+        {
+            std::vector<Coordinates> bindingOffsets;
+            Coordinates haloReach;
+            std::vector<std::vector<ssize_t> > termBindings;
+        };
+
+        BCBetweenPrepared();
+
+        /**
+         * The shape of key, registered on first use.
+         */
+        static std::shared_ptr<BCBetweenPrepared> get(std::string const& key);
+
+        std::shared_ptr<BCBetweenZoneMap> getZoneMap() const;
+        void setZoneMap(std::shared_ptr<BCBetweenZoneMap> const& zoneMap);
+
+        std::shared_ptr<std::vector<size_t> const> getTermOrder() const;
+        void setTermOrder(std::shared_ptr<std::vector<size_t> const> const& order);
+
+        std::shared_ptr<Scaffold const> getScaffold() const;
+        void setScaffold(std::shared_ptr<Scaffold const> const& scaffold);
+
+        /**
+         * The halo of key, the chunk position followed by the attribute id, or null.
+         */
+        std::shared_ptr<BCBetweenHalo const> getHalo(Coordinates const& key) const;
+        void addHalo(Coordinates const& key, std::shared_ptr<BCBetweenHalo const> const& halo);
+
+    private:
+        /**
+         * At most this many shapes are registered; the oldest one is dropped first.
+         */
+        static const size_t MAX_SHAPES = 64;
+
+        /**
+         * The halos of a shape take at most about this many bytes; the oldest ones are dropped first.
+         */
+        static const size_t MAX_HALO_BYTES = 64 * 1024 * 1024;
+
+        static size_t getSize(BCBetweenHalo const& halo);
+
+        std::shared_ptr<BCBetweenZoneMap> _zoneMap;
+        std::shared_ptr<std::vector<size_t> const> _termOrder;
+        std::shared_ptr<Scaffold const> _scaffold;
+        std::map<Coordinates, std::shared_ptr<BCBetweenHalo const>, CoordinatesLess> _halos;
+        std::deque<Coordinates> _haloOrder;
+        size_t _haloBytes;
+        mutable Mutex _mutex;
+
+        static Mutex _registryMutex;
+        static std::map<std::string, std::shared_ptr<BCBetweenPrepared> > _registry;
+        static std::deque<std::string> _registryOrder;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_PREPARED_H_ */
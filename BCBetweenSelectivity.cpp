@@ -0,0 +1,189 @@
+/*
+ * BCBetweenSelectivity.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenSelectivity.h"
+#include <array/DBArray.h>
+#include <array/SpatialRangesChunkPosIterator.h>
+#include <util/SpatialType.h>
+#include <algorithm>
+
+namespace scidb
+{
+    BCBetweenSelectivity::BCBetweenSelectivity(ArrayDesc const& inputDesc,
+                                               Coordinates const& lowPos,
+                                               Coordinates const& highPos,
+                                               Coordinates const& innerLowPos,
+                                               Coordinates const& innerHighPos,
+                                               std::shared_ptr<Expression> expr)
+            : _inputDesc(inputDesc),
+              _lowPos(lowPos),
+              _highPos(highPos),
+              _innerLowPos(innerLowPos),
+              _innerHighPos(innerHighPos),
+              _expression(expr)
+    {
+        // The inner window as it intersects the window.
+        for (size_t i = 0, n = lowPos.size(); i < n; i++)
+        {
+            _innerLowPos[i] = std::max(_innerLowPos[i], lowPos[i]);
+            _innerHighPos[i] = std::min(_innerHighPos[i], highPos[i]);
+        }
+    }
+
+    double BCBetweenSelectivity::getVolume(Coordinates const& low, Coordinates const& high)
+    {
+        double volume = 1;
+        for (size_t i = 0, n = low.size(); i < n; i++)
+        {
+            if (high[i] < low[i])
+            {
+                return 0;
+            }
+            volume *= static_cast<double>(high[i] - low[i] + 1);
+        }
+        return volume;
+    }
+
+    double BCBetweenSelectivity::estimate(std::shared_ptr<Query> const& query, bool measure) const
+    {
+        double outer = getVolume(_lowPos, _highPos);
+        if (outer == 0)
+        {
+            return 1.0;
+        }
+        double inner = getVolume(_innerLowPos, _innerHighPos);
+        double shell = outer - inner;
+        double passRate = measure && shell > 0 ? measurePassRate(query) : 1.0;
+        return (inner + shell * passRate) / outer;
+    }
+
+    bool BCBetweenSelectivity::isInShell(Coordinates const& pos) const
+    {
+        bool inInner = true;
+        for (size_t i = 0, n = pos.size(); i < n; i++)
+        {
+            if (pos[i] < _lowPos[i] || pos[i] > _highPos[i])
+            {
+                return false;
+            }
+            inInner = inInner && pos[i] >= _innerLowPos[i] && pos[i] <= _innerHighPos[i];
+        }
+        return !inInner;
+    }
+
+    double BCBetweenSelectivity::measurePassRate(std::shared_ptr<Query> const& query) const
+    {
+        std::shared_ptr<Array> input = DBArray::newDBArray(_inputDesc, query);
+        Dimensions const& dims = _inputDesc.getDimensions();
+        size_t nDims = dims.size();
+
+        AttributeDesc const* emptyTag = _inputDesc.getEmptyBitmapAttribute();
+        std::shared_ptr<ConstArrayIterator> driver = input->getConstIterator(emptyTag ? emptyTag->getId() : 0);
+        std::vector<BindInfo> const& bindings = _expression->getBindings();
+        std::vector<std::shared_ptr<ConstArrayIterator> > arrayIterators(bindings.size());
+        std::vector<std::shared_ptr<ConstChunkIterator> > chunkIterators(bindings.size());
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind == BindInfo::BI_ATTRIBUTE)
+            {
+                arrayIterators[i] = input->getConstIterator(safe_static_cast<AttributeID>(bindings[i].resolvedId));
+            }
+        }
+
+        std::shared_ptr<SpatialRanges> windowPtr = std::make_shared<SpatialRanges>(nDims);
+        windowPtr->insert(SpatialRange(_lowPos, _highPos));
+        windowPtr->buildIndex();
+        SpatialRangesChunkPosIterator chunkPosIterator(windowPtr, _inputDesc);
+
+        ExpressionContext params(*_expression);
+        for (size_t i = 0, n = bindings.size(); i < n; i++)
+        {
+            if (bindings[i].kind == BindInfo::BI_VALUE)
+            {
+                params[i] = bindings[i].value;
+            }
+        }
+
+        int mode = ConstChunkIterator::IGNORE_EMPTY_CELLS | ConstChunkIterator::IGNORE_OVERLAPS;
+        uint64_t cells = 0, passed = 0;
+        size_t probes = 0, sampled = 0;
+        for (; !chunkPosIterator.end() && probes < MAX_PROBES && sampled < MAX_SAMPLED_CHUNKS; ++chunkPosIterator)
+        {
+            // Chunks fully inside the inner window hold no shell cell.
+            Coordinates const& chunkPos = chunkPosIterator.getPosition();
+            bool fullyInside = true;
+            for (size_t d = 0; d < nDims; d++)
+            {
+                fullyInside = fullyInside && chunkPos[d] >= _innerLowPos[d] &&
+                              chunkPos[d] + dims[d].getChunkInterval() - 1 <= _innerHighPos[d];
+            }
+            if (fullyInside)
+            {
+                continue;
+            }
+
+            probes++;
+            if (!driver->setPosition(chunkPos))
+            {
+                continue;
+            }
+            sampled++;
+
+            for (size_t i = 0, n = bindings.size(); i < n; i++)
+            {
+                chunkIterators[i].reset();
+                if (arrayIterators[i] && arrayIterators[i]->setPosition(chunkPos))
+                {
+                    chunkIterators[i] = arrayIterators[i]->getChunk().getConstIterator(mode);
+                }
+            }
+
+            std::shared_ptr<ConstChunkIterator> cellIterator = driver->getChunk().getConstIterator(mode);
+            for (; !cellIterator->end(); ++(*cellIterator))
+            {
+                Coordinates const& pos = cellIterator->getPosition();
+                if (!isInShell(pos))
+                {
+                    continue;
+                }
+
+                for (size_t i = 0, n = bindings.size(); i < n; i++)
+                {
+                    switch (bindings[i].kind)
+                    {
+                        case BindInfo::BI_ATTRIBUTE:
+                        {
+                            if (chunkIterators[i] && chunkIterators[i]->setPosition(pos))
+                            {
+                                params[i] = chunkIterators[i]->getItem();
+                            } else
+                            {
+                                params[i].setNull();
+                            }
+                            break;
+                        }
+                        case BindInfo::BI_COORDINATE:
+                        {
+                            params[i].setInt64(pos[bindings[i].resolvedId]);
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                }
+
+                Value const& result = _expression->evaluate(params);
+                cells++;
+                if (!result.isNull() && result.getBool())
+                {
+                    passed++;
+                }
+            }
+        }
+
+        return cells ? static_cast<double>(passed) / cells : 1.0;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * BCBetweenSelectivity.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenSelectivity.h
+ *
+ * @brief Plan-time estimate of the fraction of the window that passes bc_between.
+ *
+ * The inner window always passes. The shell passes at the rate of the boundary expression,
+ * which is measured on a few shell chunks when the input is a stored array. The estimate runs
+ * while planning, on the coordinator, so the chunks are read from the storage of the coordinator
+ * only, before the query executes. When the coordinator holds no shell chunk, the whole shell
+ * is assumed to pass, as before.
+ */
+
+#ifndef BC_BETWEEN_SELECTIVITY_H_
+#define BC_BETWEEN_SELECTIVITY_H_
+
+#include <array/Array.h>
+#include <array/Metadata.h>
+#include <query/Operator.h>
+
+namespace scidb
+{
+    class BCBetweenSelectivity
+    {
+    public:
+        /**
+         * @param inputDesc the schema of the input array.
+         * @param lowPos the low coordinates of the window, clamped to the array bounds.
+         * @param highPos the high coordinates of the window, clamped to the array bounds.
+         * @param innerLowPos the low coordinates of the inner window.
+         * @param innerHighPos the high coordinates of the inner window.
+         * @param expr the boundary expression.
+         */
+        BCBetweenSelectivity(ArrayDesc const& inputDesc,
+                             Coordinates const& lowPos,
+                             Coordinates const& highPos,
+                             Coordinates const& innerLowPos,
+                             Coordinates const& innerHighPos,
+                             std::shared_ptr<Expression> expr);
+
+        /**
+         * The expected fraction of the window cells that pass.
+         * @param measure whether the pass rate of the boundary expression may be measured.
+         */
+        double estimate(std::shared_ptr<Query> const& query, bool measure) const;
+
+        static double getVolume(Coordinates const& low, Coordinates const& high);
+
+    private:
+        /**
+         * The fraction of the cells in the sampled shell chunks that pass the boundary expression,
+         * or 1 if no shell chunk was found.
+         */
+        double measurePassRate(std::shared_ptr<Query> const& query) const;
+
+        bool isInShell(Coordinates const& pos) const;
+
+        /**
+         * At most this many shell chunks are read, among at most MAX_PROBES window chunk positions.
+         */
+        static const size_t MAX_SAMPLED_CHUNKS = 4;
+        static const size_t MAX_PROBES = 64;
+
+        ArrayDesc _inputDesc;
+        Coordinates _lowPos;
+        Coordinates _highPos;
+        Coordinates _innerLowPos;
+        Coordinates _innerHighPos;
+        std::shared_ptr<Expression> _expression;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_SELECTIVITY_H_ */
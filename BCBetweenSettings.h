@@ -0,0 +1,703 @@
+/*
+ * BCBetweenSettings.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenSettings.h
+ *
+ * @brief Parsing of the optional trailing parameters of bc_between.
+ *
+ * After the window coordinates, bc_between accepts up to one boolean boundary
+ * condition flag per dimension, followed by any number of string options of the
+ * form 'key=value'. Both the logical and the physical operator build a
+ * BCBetweenSettings from their parameter list, so the two always agree.
+ */
+
+#ifndef BC_BETWEEN_SETTINGS_H_
+#define BC_BETWEEN_SETTINGS_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <sstream>
+#include <query/Operator.h>
+#include <system/Exceptions.h>
+
+namespace scidb
+{
+    class BCBetweenSettings
+    {
+    public:
+        enum GhostMode
+        {
+            GHOST_NONE,
+            GHOST_PERIODIC,     // wrap around the array bounds
+            GHOST_REFLECT       // mirror at the array bounds, repeating the edge cell
+        };
+
+        enum ZoneMapMode
+        {
+            ZONE_MAP_NONE,
+            ZONE_MAP_CONSTANT,  // decide the chunks whose bound attributes are constant
+            ZONE_MAP_CONVEX     // also the chunks whose min/max box passes, for a convex passing set
+        };
+
+        /**
+         * @param operatorParameters the whole parameter list of the operator.
+         * @param logical true when called from the logical operator.
+         * @param query the current query.
+         * @param nDims the number of dimensions of the input array.
+         */
+        BCBetweenSettings(std::vector<std::shared_ptr<OperatorParam> > const& operatorParameters,
+                          bool logical,
+                          std::shared_ptr<Query> const& query,
+                          size_t nDims)
+                : _nDims(nDims),
+                  _flags(nDims, false),
+                  _patchCount(0),
+                  _patchStride(nDims, 0),
+                  _sampleRate(1.0),
+                  _sampleSize(0),
+                  _sampleSeed(0),
+                  _complement(false),
+                  _ghostMode(GHOST_NONE),
+                  _zoneMap(ZONE_MAP_NONE),
+                  _stats(false),
+                  _limit(0),
+                  _reorder(false),
+                  _prepared(false),
+                  _sharedScan(false),
+                  _termsAnd(true),
+                  _hasTerms(false)
+        {
+            // Without flags, the boundary condition applies to the first dimension only, as it always has.
+            _flags[0] = true;
+            size_t nFlags = 0;
+            bool optionSeen = false;
+            bool strideSeen = false;
+            bool shellLowSeen = false;
+            bool shellHighSeen = false;
+
+            size_t nTerms = 0;
+            for (size_t i = nDims * 2 + 1, n = operatorParameters.size(); i < n; i++)
+            {
+                TypeId type;
+                bool constant;
+                if (logical)
+                {
+                    std::shared_ptr<OperatorParamLogicalExpression> const& param =
+                            (std::shared_ptr<OperatorParamLogicalExpression> const&)operatorParameters[i];
+                    type = param->getExpectedType().typeId();
+                    constant = param->isConstant();
+                } else
+                {
+                    std::shared_ptr<OperatorParamPhysicalExpression> const& param =
+                            (std::shared_ptr<OperatorParamPhysicalExpression> const&)operatorParameters[i];
+                    type = param->getExpression()->getType();
+                    constant = param->isConstant();
+                }
+
+                // Past '_terms', only the terms the logical operator appended may follow: boolean
+                // expressions of the attributes, where every parameter a user can give is a constant.
+                if (_hasTerms)
+                {
+                    if (type != TID_BOOL || constant)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: '_terms' is reserved";
+                    }
+                    if (!logical)
+                    {
+                        _terms.push_back(((std::shared_ptr<OperatorParamPhysicalExpression> const&)operatorParameters[i])->getExpression());
+                    }
+                    nTerms++;
+                    continue;
+                }
+
+                Value value;
+                if (logical)
+                {
+                    value = evaluate(((std::shared_ptr<OperatorParamLogicalExpression> const&)operatorParameters[i])->getExpression(),
+                                     query, type);
+                } else
+                {
+                    value = ((std::shared_ptr<OperatorParamPhysicalExpression> const&)operatorParameters[i])->getExpression()->evaluate();
+                }
+
+                if (type == TID_BOOL)
+                {
+                    if (optionSeen || nFlags >= nDims)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: boundary flags must precede the options";
+                    }
+                    _flags[nFlags++] = !value.isNull() && value.getBool();
+                    continue;
+                }
+
+                optionSeen = true;
+                std::string option = value.getString();
+                size_t eq = option.find('=');
+                if (eq == std::string::npos)
+                {
+                    throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                            << "bc_between: options must be of the form 'key=value', got '" + option + "'";
+                }
+                std::string key = option.substr(0, eq);
+                std::string val = option.substr(eq + 1);
+
+                if (key == "patches")
+                {
+                    int64_t count = parseInt(key, val);
+                    if (count <= 0)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'patches' must be positive";
+                    }
+                    _patchCount = count;
+                } else if (key == "stride")
+                {
+                    _patchStride = parseCoordinates(key, val);
+                    for (size_t d = 0; d < nDims; d++)
+                    {
+                        if (_patchStride[d] < 0)
+                        {
+                            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                    << "bc_between: 'stride' must not be negative";
+                        }
+                    }
+                    strideSeen = true;
+                } else if (key == "sample")
+                {
+                    _sampleRate = parseDouble(key, val);
+                    if (!(_sampleRate > 0 && _sampleRate <= 1))
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'sample' must be in (0, 1]";
+                    }
+                } else if (key == "sample_size")
+                {
+                    int64_t size = parseInt(key, val);
+                    if (size <= 0)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'sample_size' must be positive";
+                    }
+                    _sampleSize = size;
+                } else if (key == "seed")
+                {
+                    _sampleSeed = static_cast<uint64_t>(parseInt(key, val));
+                } else if (key == "export")
+                {
+                    if (val.empty())
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'export' needs a path prefix";
+                    }
+                    _exportPrefix = val;
+                } else if (key == "neighbor")
+                {
+                    size_t colon = val.find(':');
+                    if (colon == std::string::npos || colon == 0)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'neighbor' must be of the form 'attribute:d0,d1,...'";
+                    }
+                    std::string name = val.substr(0, colon);
+                    for (size_t j = 0, m = _neighbors.size(); j < m; j++)
+                    {
+                        if (_neighbors[j].first == name)
+                        {
+                            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                    << "bc_between: duplicate 'neighbor' for '" + name + "'";
+                        }
+                    }
+                    _neighbors.push_back(std::make_pair(name, parseCoordinates(key, val.substr(colon + 1))));
+                } else if (key == "complement")
+                {
+                    _complement = parseBool(key, val);
+                } else if (key == "ghost")
+                {
+                    if (val == "periodic")
+                    {
+                        _ghostMode = GHOST_PERIODIC;
+                    } else if (val == "reflect")
+                    {
+                        _ghostMode = GHOST_REFLECT;
+                    } else
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'ghost' must be 'periodic' or 'reflect'";
+                    }
+                } else if (key == "zone_map")
+                {
+                    if (val == "constant")
+                    {
+                        _zoneMap = ZONE_MAP_CONSTANT;
+                    } else if (val == "convex")
+                    {
+                        _zoneMap = ZONE_MAP_CONVEX;
+                    } else
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'zone_map' must be 'constant' or 'convex'";
+                    }
+                } else if (key == "reorder")
+                {
+                    _reorder = parseBool(key, val);
+                } else if (key == "prepared")
+                {
+                    _prepared = parseBool(key, val);
+                } else if (key == "shared_scan")
+                {
+                    _sharedScan = parseBool(key, val);
+                } else if (key == "_terms")
+                {
+                    // Appended by the logical operator for 'reorder=true': the top-level terms of the
+                    // boundary expression follow, as expressions of their own.
+                    if (val != "and" && val != "or")
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: '_terms' is reserved";
+                    }
+                    _termsAnd = val == "and";
+                    _hasTerms = true;
+                } else if (key == "limit")
+                {
+                    int64_t limit = parseInt(key, val);
+                    if (limit <= 0)
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'limit' must be positive";
+                    }
+                    _limit = static_cast<uint64_t>(limit);
+                } else if (key == "stats")
+                {
+                    _stats = parseBool(key, val);
+                } else if (key == "trace")
+                {
+                    if (val.empty())
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'trace' must not be empty";
+                    }
+                    _tracePath = val;
+                } else if (key == "cache_dir")
+                {
+                    if (val.empty())
+                    {
+                        throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                << "bc_between: 'cache_dir' must not be empty";
+                    }
+                    _cacheDir = val;
+                } else if (key == "shell_low" || key == "shell_high")
+                {
+                    Coordinates widths = parseCoordinates(key, val);
+                    for (size_t d = 0; d < nDims; d++)
+                    {
+                        if (widths[d] < 0)
+                        {
+                            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                                    << "bc_between: '" + key + "' must not be negative";
+                        }
+                    }
+                    if (key == "shell_low")
+                    {
+                        _shellLow = widths;
+                        shellLowSeen = true;
+                    } else
+                    {
+                        _shellHigh = widths;
+                        shellHighSeen = true;
+                    }
+                } else
+                {
+                    throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                            << "bc_between: unknown option '" + key + "'";
+                }
+            }
+
+            // Without explicit widths, a flagged dimension has a one cell shell on each side.
+            for (size_t d = 0; d < nDims; d++)
+            {
+                if (!shellLowSeen)
+                {
+                    _shellLow.push_back(_flags[d] ? 1 : 0);
+                }
+                if (!shellHighSeen)
+                {
+                    _shellHigh.push_back(_flags[d] ? 1 : 0);
+                }
+            }
+
+            if (_hasTerms && (nTerms == 0 || !_reorder))
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: '_terms' is reserved";
+            }
+            if (strideSeen && _patchCount == 0)
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'stride' requires 'patches'";
+            }
+            if (_sampleSize > 0 && _sampleRate < 1.0)
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'sample' and 'sample_size' are exclusive";
+            }
+            if (isPatchMode() && isSampled())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: sampling is not supported in patch mode";
+            }
+            if (isPatchMode() && isExport())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: export is not supported in patch mode";
+            }
+            if (isPatchMode() && !_neighbors.empty())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'neighbor' is not supported in patch mode";
+            }
+            if (isPatchMode() && (isMaskCached() || _stats || isTraced() || hasZoneMap() || _prepared ||
+                                  _sharedScan))
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'cache_dir', 'stats', 'trace', 'zone_map', 'prepared' and 'shared_scan' are not supported in patch mode";
+            }
+            if (_complement && (isPatchMode() || isExport()))
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: complement is not supported with patches or export";
+            }
+            if (hasGhosts() && (isPatchMode() || isExport() || _complement))
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: ghost cells are not supported with patches, export or complement";
+            }
+            if (hasGhosts() && !_neighbors.empty())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'neighbor' is not supported with ghost cells";
+            }
+            if (isLimited() && (isPatchMode() || isExport() || hasGhosts()))
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: 'limit' is not supported with patches, export or ghost cells";
+            }
+        }
+
+        /**
+         * The boundary condition flag of every dimension. Flags that were not given default to true
+         * on the first dimension and to false on the others.
+         */
+        std::vector<bool> const& getFlags() const
+        {
+            return _flags;
+        }
+
+        /**
+         * The thickness of the shell on the low and on the high side of every dimension.
+         * By default, 1 on the flagged dimensions and 0 elsewhere.
+         */
+        Coordinates const& getShellLow() const
+        {
+            return _shellLow;
+        }
+
+        Coordinates const& getShellHigh() const
+        {
+            return _shellHigh;
+        }
+
+        /**
+         * Sliding-window batch mode: emit getPatchCount() windows, each shifted by
+         * getPatchStride() from the previous one, tagged by a trailing patch dimension.
+         */
+        bool isPatchMode() const
+        {
+            return _patchCount > 0;
+        }
+
+        int64_t getPatchCount() const
+        {
+            return _patchCount;
+        }
+
+        Coordinates const& getPatchStride() const
+        {
+            return _patchStride;
+        }
+
+        /**
+         * Sampling keeps each cell that passes bc_between with probability getSampleRate(),
+         * or, given a sample size, with the probability that yields that many cells of the
+         * window on average.
+         */
+        bool isSampled() const
+        {
+            return _sampleRate < 1.0 || _sampleSize > 0;
+        }
+
+        /**
+         * @param windowVolume the number of logical cells in the window.
+         */
+        double getSampleRate(double windowVolume) const
+        {
+            if (_sampleSize > 0)
+            {
+                return windowVolume > _sampleSize ? _sampleSize / windowVolume : 1.0;
+            }
+            return _sampleRate;
+        }
+
+        uint64_t getSampleSeed() const
+        {
+            return _sampleSeed;
+        }
+
+        /**
+         * Export mode: write the window as dense memory-mapped buffers instead of returning it.
+         */
+        bool isExport() const
+        {
+            return !_exportPrefix.empty();
+        }
+
+        std::string const& getExportPrefix() const
+        {
+            return _exportPrefix;
+        }
+
+        /**
+         * Stencil bindings: the boundary expression reads each listed attribute at the given
+         * offset from the cell, instead of at the cell itself.
+         */
+        std::vector<std::pair<std::string, Coordinates> > const& getNeighbors() const
+        {
+            return _neighbors;
+        }
+
+        /**
+         * Ghost cells: the window is not clamped to the array bounds, and its cells beyond the
+         * bounds are filled with periodic or mirrored copies of the cells inside, and checked against
+         * the boundary expression in the shell.
+         */
+        bool hasGhosts() const
+        {
+            return _ghostMode != GHOST_NONE;
+        }
+
+        GhostMode getGhostMode() const
+        {
+            return _ghostMode;
+        }
+
+        /**
+         * Complement mode: select exactly the cells that bc_between would drop, i.e. the cells
+         * outside the window and the shell cells that fail the boundary expression.
+         */
+        bool isComplement() const
+        {
+            return _complement;
+        }
+
+        /**
+         * Mask cache: keep the per-chunk results of the boundary expression on the shell in
+         * getCacheDir(), and reuse them for the same input version, window and expression.
+         */
+        bool isMaskCached() const
+        {
+            return !_cacheDir.empty();
+        }
+
+        std::string const& getCacheDir() const
+        {
+            return _cacheDir;
+        }
+
+        /**
+         * Zone maps: decide the boundary expression for a whole chunk from the synopses of its bound
+         * attributes, and skip the evaluation on its cells. The synopses are stored in getCacheDir().
+         */
+        bool hasZoneMap() const
+        {
+            return _zoneMap != ZONE_MAP_NONE;
+        }
+
+        ZoneMapMode getZoneMapMode() const
+        {
+            return _zoneMap;
+        }
+
+        /**
+         * Instrumentation: count what the operator does, and report it at the end of the query.
+         */
+        bool isStats() const
+        {
+            return _stats;
+        }
+
+        /**
+         * Tracing: record the phases of the chunk iteration, and write them as a Chrome trace.
+         */
+        bool isTraced() const
+        {
+            return !_tracePath.empty();
+        }
+
+        std::string const& getTracePath() const
+        {
+            return _tracePath;
+        }
+
+        /**
+         * Limit: every instance returns at most getLimit() cells, from the chunks it reaches first,
+         * and stops reading chunks and evaluating the boundary expression once they are found.
+         */
+        bool isLimited() const
+        {
+            return _limit > 0;
+        }
+
+        uint64_t getLimit() const
+        {
+            return _limit;
+        }
+
+        /**
+         * Reordering: evaluate the terms of a top-level and/or chain of the boundary expression apart,
+         * cheapest and most decisive first, as measured on the first shell cells.
+         * hasTerms() tells whether the logical operator has appended the terms; getTerms() holds them,
+         * in the physical operator only.
+         */
+        bool isReordered() const
+        {
+            return _reorder;
+        }
+
+        bool hasTerms() const
+        {
+            return _hasTerms;
+        }
+
+        bool isTermsAnd() const
+        {
+            return _termsAnd;
+        }
+
+        std::vector<std::shared_ptr<Expression> > const& getTerms() const
+        {
+            return _terms;
+        }
+
+        /**
+         * Prepared: share the zone map, the term order and the chunk ranges of the windows with the
+         * other queries of the same expression on the same stored array version.
+         */
+        bool isPrepared() const
+        {
+            return _prepared;
+        }
+
+        /**
+         * Shared scan: read every input chunk once for the concurrent queries on the same stored array version.
+         */
+        bool isSharedScan() const
+        {
+            return _sharedScan;
+        }
+
+    private:
+        static int64_t parseInt(std::string const& key, std::string const& val)
+        {
+            std::istringstream iss(val);
+            int64_t result;
+            iss >> result;
+            if (iss.fail() || !iss.eof())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: cannot parse '" + key + "=" + val + "' as an integer";
+            }
+            return result;
+        }
+
+        static bool parseBool(std::string const& key, std::string const& val)
+        {
+            if (val == "true" || val == "1")
+            {
+                return true;
+            }
+            if (val == "false" || val == "0")
+            {
+                return false;
+            }
+            throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                    << "bc_between: cannot parse '" + key + "=" + val + "' as a boolean";
+        }
+
+        static double parseDouble(std::string const& key, std::string const& val)
+        {
+            std::istringstream iss(val);
+            double result;
+            iss >> result;
+            if (iss.fail() || !iss.eof())
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: cannot parse '" + key + "=" + val + "' as a number";
+            }
+            return result;
+        }
+
+        /**
+         * Parse a comma separated list with exactly one value per dimension.
+         */
+        Coordinates parseCoordinates(std::string const& key, std::string const& val) const
+        {
+            Coordinates result;
+            std::istringstream iss(val);
+            std::string item;
+            while (std::getline(iss, item, ','))
+            {
+                result.push_back(parseInt(key, item));
+            }
+            if (result.size() != _nDims)
+            {
+                throw USER_EXCEPTION(SCIDB_SE_OPERATOR, SCIDB_LE_ILLEGAL_OPERATION)
+                        << "bc_between: '" + key + "' needs one value per dimension";
+            }
+            return result;
+        }
+
+    private:
+        size_t _nDims;
+        std::vector<bool> _flags;
+        Coordinates _shellLow;
+        Coordinates _shellHigh;
+        int64_t _patchCount;
+        Coordinates _patchStride;
+        double _sampleRate;
+        int64_t _sampleSize;
+        uint64_t _sampleSeed;
+        std::string _exportPrefix;
+        std::vector<std::pair<std::string, Coordinates> > _neighbors;
+        bool _complement;
+        GhostMode _ghostMode;
+        std::string _cacheDir;
+        ZoneMapMode _zoneMap;
+        bool _stats;
+        std::string _tracePath;
+        uint64_t _limit;
+        bool _reorder;
+        bool _prepared;
+        bool _sharedScan;
+        bool _termsAnd;
+        bool _hasTerms;
+        std::vector<std::shared_ptr<Expression> > _terms;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_SETTINGS_H_ */
@@ -0,0 +1,232 @@
+/*
+ * BCBetweenSharedScan.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenSharedScan.h"
+#include <cstring>
+
+namespace scidb
+{
+    Mutex BCBetweenSharedScan::_registryMutex;
+    std::map<std::string, std::weak_ptr<BCBetweenSharedScan> > BCBetweenSharedScan::_registry;
+
+    std::shared_ptr<BCBetweenSharedScan> BCBetweenSharedScan::get(std::string const& key)
+    {
+        ScopedMutexLock cs(_registryMutex);
+        std::shared_ptr<BCBetweenSharedScan> scan = _registry[key].lock();
+        if (!scan)
+        {
+            scan = std::make_shared<BCBetweenSharedScan>();
+            _registry[key] = scan;
+        }
+
+        // Drop the scans no query is in anymore.
+        for (std::map<std::string, std::weak_ptr<BCBetweenSharedScan> >::iterator it = _registry.begin();
+             it != _registry.end();)
+        {
+            if (it->second.expired())
+            {
+                _registry.erase(it++);
+            } else
+            {
+                ++it;
+            }
+        }
+        return scan;
+    }
+
+    BCBetweenSharedScan::BCBetweenSharedScan()
+            : _bytes(0),
+              _nextReader(0),
+              _nextCursor(0)
+    {
+    }
+
+    bool BCBetweenSharedScan::Reader::reaches(Coordinates const& chunkPos) const
+    {
+        CoordinatesLess less;
+        for (std::map<uint64_t, Coordinates>::const_iterator it = cursors.begin(); it != cursors.end(); ++it)
+        {
+            if (it->second.empty() || !less(chunkPos, it->second))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t BCBetweenSharedScan::join(std::shared_ptr<SpatialRanges> const& chunkRanges)
+    {
+        ScopedMutexLock cs(_mutex);
+        uint64_t reader = _nextReader++;
+        _readers[reader].chunkRanges = chunkRanges;
+        return reader;
+    }
+
+    void BCBetweenSharedScan::addAttribute(uint64_t reader, AttributeID attrID)
+    {
+        ScopedMutexLock cs(_mutex);
+        _readers[reader].attributes.insert(attrID);
+    }
+
+    void BCBetweenSharedScan::leave(uint64_t reader)
+    {
+        ScopedMutexLock cs(_mutex);
+        _readers.erase(reader);
+        for (std::map<Key, Entry>::iterator it = _chunks.begin(); it != _chunks.end();)
+        {
+            it = release(it, reader);
+        }
+    }
+
+    uint64_t BCBetweenSharedScan::addCursor(uint64_t reader)
+    {
+        ScopedMutexLock cs(_mutex);
+        uint64_t cursor = _nextCursor++;
+        std::map<uint64_t, Reader>::iterator it = _readers.find(reader);
+        if (it != _readers.end())
+        {
+            it->second.cursors[cursor] = Coordinates();
+        }
+        return cursor;
+    }
+
+    void BCBetweenSharedScan::removeCursor(uint64_t reader, uint64_t cursor)
+    {
+        moveCursor(reader, cursor, Coordinates());
+    }
+
+    void BCBetweenSharedScan::moveCursor(uint64_t reader, uint64_t cursor, Coordinates const& chunkPos)
+    {
+        ScopedMutexLock cs(_mutex);
+        std::map<uint64_t, Reader>::iterator it = _readers.find(reader);
+        if (it == _readers.end())
+        {
+            return;
+        }
+        Reader& state = it->second;
+        if (chunkPos.empty())
+        {
+            state.cursors.erase(cursor);
+        } else
+        {
+            state.cursors[cursor] = chunkPos;
+        }
+
+        // A copy the reader will not reach anymore would only be pinned for it.
+        for (std::map<Key, Entry>::iterator chunk = _chunks.begin(); chunk != _chunks.end();)
+        {
+            if (chunk->second.waiting.count(reader) && !state.reaches(chunk->first.second))
+            {
+                chunk = release(chunk, reader);
+            } else
+            {
+                ++chunk;
+            }
+        }
+    }
+
+    std::map<BCBetweenSharedScan::Key, BCBetweenSharedScan::Entry>::iterator
+    BCBetweenSharedScan::release(std::map<Key, Entry>::iterator it, uint64_t reader)
+    {
+        it->second.waiting.erase(reader);
+        if (!it->second.waiting.empty())
+        {
+            return ++it;
+        }
+        _bytes -= it->second.size;
+        _chunks.erase(it++);
+        return it;
+    }
+
+    std::shared_ptr<ConstChunk> BCBetweenSharedScan::take(Key const& key, uint64_t reader)
+    {
+        std::map<Key, Entry>::iterator it = _chunks.find(key);
+        if (it == _chunks.end())
+        {
+            return std::shared_ptr<ConstChunk>();
+        }
+        std::shared_ptr<ConstChunk> chunk = it->second.chunk;
+        _readers[reader].read.insert(key);
+        release(it, reader);
+        return chunk;
+    }
+
+    std::set<uint64_t> BCBetweenSharedScan::getWaiting(Key const& key, uint64_t reader) const
+    {
+        std::set<uint64_t> waiting;
+        size_t hint = 0;
+        for (std::map<uint64_t, Reader>::const_iterator it = _readers.begin(); it != _readers.end(); ++it)
+        {
+            if (it->first != reader && it->second.attributes.count(key.first) && !it->second.read.count(key) &&
+                it->second.reaches(key.second) && it->second.chunkRanges->findOneThatContains(key.second, hint))
+            {
+                waiting.insert(it->first);
+            }
+        }
+        return waiting;
+    }
+
+    std::shared_ptr<ConstChunk> BCBetweenSharedScan::getChunk(uint64_t reader, AttributeID attrID,
+                                                              Coordinates const& chunkPos,
+                                                              ConstArrayIterator& input,
+                                                              std::shared_ptr<Array> const& inputArray, bool& shared)
+    {
+        Key key(attrID, chunkPos);
+        shared = false;
+        {
+            ScopedMutexLock cs(_mutex);
+            std::shared_ptr<ConstChunk> chunk = take(key, reader);
+            if (chunk)
+            {
+                shared = true;
+                return chunk;
+            }
+
+            // With no other reader to come, nothing is copied.
+            if (_bytes >= MAX_SHARED_BYTES || getWaiting(key, reader).empty())
+            {
+                _readers[reader].read.insert(key);
+                return std::shared_ptr<ConstChunk>();
+            }
+        }
+
+        // Copy outside the lock, so that the readers of other chunks do not wait for this one.
+        // The copy refers to the array and descriptor of the input, so it keeps the input alive.
+        ConstChunk const& src = input.getChunk();
+        std::shared_ptr<Copy> copy = std::make_shared<Copy>();
+        copy->inputArray = inputArray;
+        {
+            PinBuffer scope(src);
+            copy->chunk.initialize(src);
+            copy->chunk.allocate(src.getSize());
+            memcpy(copy->chunk.getData(), src.getData(), src.getSize());
+        }
+        std::shared_ptr<ConstChunk> result(copy, &copy->chunk);
+
+        // Another reader may have copied it meanwhile; take its copy, which the others wait for.
+        ScopedMutexLock cs(_mutex);
+        std::shared_ptr<ConstChunk> chunk = take(key, reader);
+        if (chunk)
+        {
+            shared = true;
+            return chunk;
+        }
+        _readers[reader].read.insert(key);
+
+        // The readers may have moved on or left meanwhile.
+        std::set<uint64_t> waiting = getWaiting(key, reader);
+        size_t size = copy->chunk.getSize();
+        if (!waiting.empty() && _bytes + size <= MAX_SHARED_BYTES)
+        {
+            Entry& entry = _chunks[key];
+            entry.chunk = result;
+            entry.size = size;
+            entry.waiting.swap(waiting);
+            _bytes += size;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * BCBetweenSharedScan.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenSharedScan.h
+ *
+ * @brief One read of a chunk for the concurrent bc_between queries on the same array version.
+ *
+ * With 'shared_scan=true', every BCBetweenArray on a stored array version joins the scan of that version
+ * on its instance, with the chunk ranges of its window and the attributes it reads. The first query to
+ * reach a chunk reads it and, when other queries will also reach it, keeps a copy for them; each of them
+ * takes the copy instead of reading and decoding the chunk again, and filters it with its own window and
+ * expression. A query reaches a chunk while one of its array iterators, its cursors, is at or before the
+ * chunk in row-major order; an iterator that skips past a chunk, or ends, drops the query from the chunk.
+ * The copy is dropped once every such query took it, moved past it or left the scan. A chunk no other
+ * query will reach is not copied. The copies of a scan take at most MAX_SHARED_BYTES; beyond, a chunk is
+ * read by every query as usual.
+ */
+
+#ifndef BC_BETWEEN_SHARED_SCAN_H_
+#define BC_BETWEEN_SHARED_SCAN_H_
+
+#include <array/Array.h>
+#include <array/MemArray.h>
+#include <array/Metadata.h>
+#include <util/Mutex.h>
+#include <util/SpatialType.h>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace scidb
+{
+    class BCBetweenSharedScan
+    {
+    public:
+        /**
+         * The scan of key, alive while a query is in it.
+         */
+        static std::shared_ptr<BCBetweenSharedScan> get(std::string const& key);
+
+        BCBetweenSharedScan();
+
+        /**
+         * Join the scan as a new reader of the chunks within chunkRanges.
+         * @return the id of the reader.
+         */
+        uint64_t join(std::shared_ptr<SpatialRanges> const& chunkRanges);
+
+        /**
+         * Read attrID as well; its chunks stored before are not kept for the reader.
+         */
+        void addAttribute(uint64_t reader, AttributeID attrID);
+
+        void leave(uint64_t reader);
+
+        /**
+         * Add a cursor of reader, before its first chunk.
+         * @return the id of the cursor.
+         */
+        uint64_t addCursor(uint64_t reader);
+        void removeCursor(uint64_t reader, uint64_t cursor);
+
+        /**
+         * Move a cursor of reader to chunkPos, or past its last chunk if chunkPos is empty. The reader is
+         * dropped from the chunks that none of its cursors will reach anymore.
+         */
+        void moveCursor(uint64_t reader, uint64_t cursor, Coordinates const& chunkPos);
+
+        /**
+         * The chunk of attrID at chunkPos: the copy of another reader, or else a copy of the chunk of input,
+         * which must be at chunkPos, kept for the other readers that will reach it. Null when no other
+         * reader will, so that the reader reads the chunk of input itself.
+         * @param inputArray the array input iterates, kept alive with the copy.
+         * @param[out] shared whether the copy was made by another reader.
+         */
+        std::shared_ptr<ConstChunk> getChunk(uint64_t reader, AttributeID attrID, Coordinates const& chunkPos,
+                                             ConstArrayIterator& input, std::shared_ptr<Array> const& inputArray,
+                                             bool& shared);
+
+    private:
+        typedef std::pair<AttributeID, Coordinates> Key;
+
+        struct Reader
+        {
+            std::shared_ptr<SpatialRanges> chunkRanges;
+            std::set<AttributeID> attributes;
+            std::set<Key> read;             // the chunks the reader has already got
+            std::map<uint64_t, Coordinates> cursors; // empty before the first chunk; ended cursors are erased
+
+            /**
+             * Whether a cursor of the reader is at or before chunkPos.
+             */
+            bool reaches(Coordinates const& chunkPos) const;
+        };
+
+        /**
+         * A copied chunk, with the array of the reader that copied it, which the chunk refers to.
+         */
+        struct Copy
+        {
+            std::shared_ptr<Array> inputArray;
+            MemChunk chunk;
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<ConstChunk> chunk;
+            size_t size;
+            std::set<uint64_t> waiting;     // the readers that have yet to take the chunk
+        };
+
+        /**
+         * Take the chunk of key, if kept, for reader. Called with _mutex held.
+         */
+        std::shared_ptr<ConstChunk> take(Key const& key, uint64_t reader);
+
+        /**
+         * The other readers that will reach the chunk of key and have not got it. Called with _mutex held.
+         */
+        std::set<uint64_t> getWaiting(Key const& key, uint64_t reader) const;
+
+        /**
+         * Drop reader from the chunk at it, and the chunk once no reader waits for it. Called with _mutex held.
+         * @return the next chunk.
+         */
+        std::map<Key, Entry>::iterator release(std::map<Key, Entry>::iterator it, uint64_t reader);
+
+        static const size_t MAX_SHARED_BYTES = 256 * 1024 * 1024;
+
+        std::map<uint64_t, Reader> _readers;
+        std::map<Key, Entry> _chunks;
+        size_t _bytes;
+        uint64_t _nextReader;
+        uint64_t _nextCursor;
+        Mutex _mutex;
+
+        static Mutex _registryMutex;
+        static std::map<std::string, std::weak_ptr<BCBetweenSharedScan> > _registry;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_SHARED_SCAN_H_ */
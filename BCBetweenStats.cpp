@@ -0,0 +1,105 @@
+/*
+ * BCBetweenStats.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenStats.h"
+#include <log4cxx/logger.h>
+#include <sstream>
+#include <time.h>
+
+namespace scidb
+{
+    static log4cxx::LoggerPtr logger(log4cxx::Logger::getLogger("scidb.bc_between"));
+
+    Mutex BCBetweenStats::_registryMutex;
+    std::deque<BCBetweenStats::Report> BCBetweenStats::_registry;
+
+    BCBetweenStats::BCBetweenStats()
+    {
+        for (size_t i = 0; i < N_COUNTERS; i++)
+        {
+            _counters[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    char const* BCBetweenStats::getName(Counter counter)
+    {
+        static char const* const names[N_COUNTERS] = {
+                "chunks_visited",
+                "chunks_fully_inside",
+                "chunks_fully_outside",
+                "chunks_partial",
+                "probes",
+                "failed_probes",
+                "cells_scanned",
+                "shell_evaluated",
+                "shell_passed",
+                "bitmap_cache_hits",
+                "bitmap_cache_misses",
+                "evaluate_nanos",
+                "chunks_zone_decided",
+                "chunks_shared"
+        };
+        return names[counter];
+    }
+
+    void BCBetweenStats::add(uint64_t const* counts)
+    {
+        for (size_t i = 0; i < N_COUNTERS; i++)
+        {
+            if (counts[i])
+            {
+                _counters[i].fetch_add(counts[i], std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::string BCBetweenStats::toString() const
+    {
+        std::ostringstream oss;
+        for (size_t i = 0; i < N_COUNTERS; i++)
+        {
+            oss << (i ? ", " : "") << getName(static_cast<Counter>(i)) << "=" << get(static_cast<Counter>(i));
+        }
+        uint64_t evaluated = get(SHELL_EVALUATED);
+        if (evaluated)
+        {
+            oss << ", pass_rate=" << static_cast<double>(get(SHELL_PASSED)) / evaluated;
+        }
+        return oss.str();
+    }
+
+    void BCBetweenStats::publish(std::string const& queryID) const
+    {
+        LOG4CXX_INFO(logger, "bc_between stats of query " << queryID << ": " << toString());
+
+        Report report;
+        report.queryID = queryID;
+        for (size_t i = 0; i < N_COUNTERS; i++)
+        {
+            report.values[i] = get(static_cast<Counter>(i));
+        }
+
+        ScopedMutexLock cs(_registryMutex);
+        _registry.push_back(report);
+        if (_registry.size() > MAX_REPORTS)
+        {
+            _registry.pop_front();
+        }
+    }
+
+    std::vector<BCBetweenStats::Report> BCBetweenStats::getReports()
+    {
+        ScopedMutexLock cs(_registryMutex);
+        return std::vector<Report>(_registry.begin(), _registry.end());
+    }
+
+    uint64_t BCBetweenStats::now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * BCBetweenStats.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenStats.h
+ *
+ * @brief Instrumentation counters of bc_between.
+ *
+ * With 'stats=true', a BCBetweenArray counts what it does on every instance. When the array is
+ * released at the end of the query, the counters are written to the SciDB log and kept in a
+ * registry of the last MAX_REPORTS reports of the instance, which bc_between_stats() returns.
+ *
+ * Without the option, the array holds no stats and every counting site costs a null check.
+ * Cell-level counters are first summed in each chunk iterator and added once, when it is destroyed.
+ */
+
+#ifndef BC_BETWEEN_STATS_H_
+#define BC_BETWEEN_STATS_H_
+
+#include <util/Mutex.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace scidb
+{
+    class BCBetweenStats
+    {
+    public:
+        enum Counter
+        {
+            CHUNKS_VISITED,         // attribute chunks set up by the array iterators
+            CHUNKS_FULLY_INSIDE,    // ... passed through as they are
+            CHUNKS_FULLY_OUTSIDE,   // ... with no selected cell
+            CHUNKS_PARTIAL,         // ... filtered cell by cell
+            PROBES,                 // input chunk positions probed in advanceToNextChunkInRange
+            FAILED_PROBES,          // ... that do not exist
+            CELLS_SCANNED,          // cells filtered, once per cell the consumer moves over
+            SHELL_EVALUATED,        // shell cells the boundary expression was evaluated on
+            SHELL_PASSED,           // ... that passed
+            BITMAP_CACHE_HITS,      // empty bitmap chunks found in the cache
+            BITMAP_CACHE_MISSES,    // ... built anew
+            EVALUATE_NANOS,         // time spent in evaluate()
+            CHUNKS_ZONE_DECIDED,    // partial chunks whose shell was decided by the zone map
+            CHUNKS_SHARED,          // input chunks taken from the read of another query
+            N_COUNTERS
+        };
+
+        struct Report
+        {
+            std::string queryID;
+            uint64_t values[N_COUNTERS];
+        };
+
+        /**
+         * At most this many reports are kept per instance; the oldest one is dropped first.
+         */
+        static const size_t MAX_REPORTS = 1024;
+
+        BCBetweenStats();
+
+        static char const* getName(Counter counter);
+
+        void add(Counter counter, uint64_t n)
+        {
+            _counters[counter].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        /**
+         * Add counts summed elsewhere, one per counter.
+         */
+        void add(uint64_t const* counts);
+
+        uint64_t get(Counter counter) const
+        {
+            return _counters[counter].load(std::memory_order_relaxed);
+        }
+
+        std::string toString() const;
+
+        /**
+         * Log the counters and keep them in the registry.
+         */
+        void publish(std::string const& queryID) const;
+
+        /**
+         * The reports of this instance, oldest first.
+         */
+        static std::vector<Report> getReports();
+
+        /**
+         * Monotonic clock, in nanoseconds.
+         */
+        static uint64_t now();
+
+    private:
+        std::atomic<uint64_t> _counters[N_COUNTERS];
+
+        static Mutex _registryMutex;
+        static std::deque<Report> _registry;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_STATS_H_ */
@@ -0,0 +1,104 @@
+/*
+ * BCBetweenTrace.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenTrace.h"
+#include "BCBetweenArray.h"
+#include <log4cxx/logger.h>
+#include <fstream>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace scidb
+{
+    static log4cxx::LoggerPtr logger(log4cxx::Logger::getLogger("scidb.bc_between"));
+
+    BCBetweenTrace::BCBetweenTrace(std::string const& path, QueryID queryID, InstanceID instanceID)
+            : _instanceID(instanceID)
+    {
+        std::ostringstream oss;
+        oss << path << "." << queryID << "." << instanceID << ".json";
+        _path = oss.str();
+    }
+
+    void BCBetweenTrace::record(char const* name, uint64_t start, uint64_t duration,
+                                Coordinates const& chunkPos, AttributeID attrID)
+    {
+        Event event;
+        event.name = name;
+        event.phase = 'X';
+        event.start = start;
+        event.duration = duration;
+        event.threadID = ::syscall(SYS_gettid);
+        event.chunkPos = chunkPos;
+        event.attrID = attrID;
+
+        ScopedMutexLock cs(_mutex);
+        _events.push_back(event);
+    }
+
+    void BCBetweenTrace::count(char const* name, uint64_t value)
+    {
+        Event event;
+        event.name = name;
+        event.phase = 'C';
+        event.start = BCBetweenStats::now();
+        event.duration = value;
+        event.threadID = ::syscall(SYS_gettid);
+        event.attrID = 0;
+
+        ScopedMutexLock cs(_mutex);
+        _events.push_back(event);
+    }
+
+    BCBetweenTrace::~BCBetweenTrace()
+    {
+        std::ofstream out(_path.c_str());
+        out << "{\"traceEvents\": [";
+        for (size_t i = 0, n = _events.size(); i < n; i++)
+        {
+            Event const& event = _events[i];
+            out << (i ? ",\n" : "\n") << "{\"name\": \"" << event.name << "\", \"cat\": \"bc_between\", \"ph\": \"" << event.phase << "\""
+                << ", \"ts\": " << event.start / 1000 << "." << (event.start % 1000) / 100
+                << ", \"pid\": " << _instanceID << ", \"tid\": " << event.threadID;
+            if (event.phase == 'C')
+            {
+                out << ", \"args\": {\"value\": " << event.duration << "}}";
+                continue;
+            }
+            out << ", \"dur\": " << event.duration / 1000 << "." << (event.duration % 1000) / 100
+                << ", \"args\": {\"chunk\": \"" << coordinateToString(event.chunkPos) << "\", \"attr\": " << event.attrID << "}}";
+        }
+        out << "\n]}\n";
+
+        // Never throw from a destructor; a lost trace is only logged.
+        if (!out)
+        {
+            LOG4CXX_WARN(logger, "bc_between: cannot write the trace to " << _path);
+        }
+    }
+
+    BCBetweenTrace::Span::Span(BCBetweenTrace* trace, char const* name, Coordinates const& chunkPos, AttributeID attrID)
+            : _trace(trace),
+              _name(name),
+              _attrID(attrID),
+              _start(0)
+    {
+        if (_trace)
+        {
+            _chunkPos = chunkPos;
+            _start = BCBetweenStats::now();
+        }
+    }
+
+    BCBetweenTrace::Span::~Span()
+    {
+        if (_trace)
+        {
+            _trace->record(_name, _start, BCBetweenStats::now() - _start, _chunkPos, _attrID);
+        }
+    }
+}
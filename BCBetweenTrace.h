@@ -0,0 +1,92 @@
+/*
+ * BCBetweenTrace.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenTrace.h
+ *
+ * @brief Chrome trace of the chunk iteration of bc_between.
+ *
+ * With 'trace=path', a BCBetweenArray records a timed span for every phase it goes through on a chunk:
+ * fetching the input chunk, classifying it, constructing a chunk iterator, evaluating the shell and
+ * materializing the empty bitmap. Each span carries the thread, the chunk position and the attribute.
+ * The time spent evaluating the shell cells a chunk iterator handed out, which is spread over the pulls
+ * of the consumer, is recorded as a counter instead. When the array is released, the events are written
+ * to <path>.<query>.<instance>.json in the Chrome trace event format, which chrome://tracing and Perfetto
+ * open; the instance is the process ID of the trace.
+ */
+
+#ifndef BC_BETWEEN_TRACE_H_
+#define BC_BETWEEN_TRACE_H_
+
+#include <array/Metadata.h>
+#include <query/Query.h>
+#include <util/Mutex.h>
+#include <string>
+#include <vector>
+
+namespace scidb
+{
+    class BCBetweenTrace
+    {
+    public:
+        BCBetweenTrace(std::string const& path, QueryID queryID, InstanceID instanceID);
+
+        /**
+         * Write the trace file.
+         */
+        ~BCBetweenTrace();
+
+        /**
+         * @param name a string literal naming the phase.
+         * @param start the start time, from BCBetweenStats::now().
+         * @param duration the duration, in nanoseconds.
+         */
+        void record(char const* name, uint64_t start, uint64_t duration,
+                    Coordinates const& chunkPos, AttributeID attrID);
+
+        /**
+         * Record value as the counter name at the current time.
+         * @param name a string literal naming the counter.
+         */
+        void count(char const* name, uint64_t value);
+
+        /**
+         * Records the span from its construction to its destruction. With a null trace, it does nothing.
+         */
+        class Span
+        {
+        public:
+            Span(BCBetweenTrace* trace, char const* name, Coordinates const& chunkPos, AttributeID attrID);
+            ~Span();
+
+        private:
+            BCBetweenTrace* _trace;
+            char const* _name;
+            Coordinates _chunkPos;
+            AttributeID _attrID;
+            uint64_t _start;
+        };
+
+    private:
+        struct Event
+        {
+            char const* name;
+            char phase;                 // 'X' for a span, 'C' for a counter, whose value is in duration
+            uint64_t start;
+            uint64_t duration;
+            long threadID;
+            Coordinates chunkPos;
+            AttributeID attrID;
+        };
+
+        std::string _path;
+        InstanceID _instanceID;
+        std::vector<Event> _events;
+        Mutex _mutex;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_TRACE_H_ */
@@ -0,0 +1,223 @@
+/*
+ * BCBetweenZoneMap.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "BCBetweenZoneMap.h"
+#include "BCBetweenMaskCache.h"
+#include <system/Exceptions.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+
+namespace scidb
+{
+    /**
+     * Widen [min, max] of synopsis to value, compared as T, so that 64-bit integers keep every bit.
+     * A NaN has no place in the order, so a chunk holding one is unordered.
+     */
+    template <typename T>
+    static void widen(BCBetweenSynopsis& synopsis, Value const& value)
+    {
+        T v = value.get<T>();
+        if (v != v)
+        {
+            synopsis.ordered = false;
+        } else if (v < synopsis.min.get<T>())
+        {
+            synopsis.min = value;
+        } else if (v > synopsis.max.get<T>())
+        {
+            synopsis.max = value;
+        }
+    }
+
+    typedef void (*Widen)(BCBetweenSynopsis& synopsis, Value const& value);
+
+    /**
+     * The widen() of the numeric type, or null for any other type.
+     */
+    static Widen getWiden(TypeId const& type)
+    {
+        if (type == TID_INT8) return &widen<int8_t>;
+        if (type == TID_INT16) return &widen<int16_t>;
+        if (type == TID_INT32) return &widen<int32_t>;
+        if (type == TID_INT64) return &widen<int64_t>;
+        if (type == TID_UINT8) return &widen<uint8_t>;
+        if (type == TID_UINT16) return &widen<uint16_t>;
+        if (type == TID_UINT32) return &widen<uint32_t>;
+        if (type == TID_UINT64) return &widen<uint64_t>;
+        if (type == TID_FLOAT) return &widen<float>;
+        if (type == TID_DOUBLE) return &widen<double>;
+        return NULL;
+    }
+
+    BCBetweenZoneMap::BCBetweenZoneMap(std::string const& dir, std::string const& key)
+    {
+        if (dir.empty())
+        {
+            return;
+        }
+
+        _dir = dir + "/zone_" + BCBetweenMaskCache::hash(key);
+        if ((::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) ||
+            (::mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST))
+        {
+            throw USER_EXCEPTION(SCIDB_SE_IO, SCIDB_LE_CANT_OPEN_FILE) << _dir << ::strerror(errno) << errno;
+        }
+    }
+
+    std::shared_ptr<BCBetweenSynopsis const> BCBetweenZoneMap::build(ConstChunk const& chunk)
+    {
+        std::shared_ptr<BCBetweenSynopsis> synopsis = std::make_shared<BCBetweenSynopsis>();
+        Widen widenTo = getWiden(chunk.getAttributeDesc().getType());
+        synopsis->ordered = widenTo != NULL;
+
+        std::shared_ptr<ConstChunkIterator> it = chunk.getConstIterator(ConstChunkIterator::IGNORE_EMPTY_CELLS);
+        for (; !it->end(); ++(*it))
+        {
+            Value const& value = it->getItem();
+            if (value.isNull())
+            {
+                synopsis->hasNulls = true;
+                continue;
+            }
+            if (!synopsis->hasCells)
+            {
+                synopsis->hasCells = true;
+                synopsis->min = value;
+                synopsis->max = value;
+            } else if (synopsis->constant && !(value == synopsis->min))
+            {
+                synopsis->constant = false;
+            }
+            if (synopsis->ordered)
+            {
+                widenTo(*synopsis, value);
+            }
+        }
+        return synopsis;
+    }
+
+    std::string BCBetweenZoneMap::getPath(Key const& key) const
+    {
+        std::ostringstream oss;
+        oss << _dir << "/" << key.first;
+        for (size_t i = 0, n = key.second.size(); i < n; i++)
+        {
+            oss << "_" << key.second[i];
+        }
+        oss << ".zone";
+        return oss.str();
+    }
+
+    std::shared_ptr<BCBetweenSynopsis const> BCBetweenZoneMap::load(Key const& key) const
+    {
+        std::ifstream in(getPath(key).c_str(), std::ios::binary);
+        if (!in)
+        {
+            return std::shared_ptr<BCBetweenSynopsis const>();
+        }
+
+        // The flags, then the size and the bytes of min and of max.
+        std::shared_ptr<BCBetweenSynopsis> synopsis = std::make_shared<BCBetweenSynopsis>();
+        uint8_t flags = 0;
+        in.read(reinterpret_cast<char*>(&flags), sizeof(flags));
+        synopsis->hasCells = flags & 1;
+        synopsis->hasNulls = flags & 2;
+        synopsis->constant = flags & 4;
+        synopsis->ordered = flags & 8;
+        for (Value* value : { &synopsis->min, &synopsis->max })
+        {
+            uint32_t size = 0;
+            in.read(reinterpret_cast<char*>(&size), sizeof(size));
+            std::string bytes(size, '\0');
+            in.read(&bytes[0], size);
+            value->setData(bytes.data(), size);
+        }
+
+        // A truncated synopsis is built again.
+        if (!in || in.peek() != EOF)
+        {
+            return std::shared_ptr<BCBetweenSynopsis const>();
+        }
+        return synopsis;
+    }
+
+    void BCBetweenZoneMap::store(Key const& key, BCBetweenSynopsis const& synopsis) const
+    {
+        // Write to a file of this process, then rename, so that a reader never sees a partial synopsis.
+        std::string path = getPath(key);
+        std::ostringstream tmp;
+        tmp << path << "." << ::getpid() << "." << pthread_self();
+        {
+            std::ofstream out(tmp.str().c_str(), std::ios::binary | std::ios::trunc);
+            uint8_t flags = (synopsis.hasCells ? 1 : 0) | (synopsis.hasNulls ? 2 : 0) |
+                            (synopsis.constant ? 4 : 0) | (synopsis.ordered ? 8 : 0);
+            out.write(reinterpret_cast<char const*>(&flags), sizeof(flags));
+            for (Value const* value : { &synopsis.min, &synopsis.max })
+            {
+                uint32_t size = safe_static_cast<uint32_t>(value->size());
+                out.write(reinterpret_cast<char const*>(&size), sizeof(size));
+                out.write(static_cast<char const*>(value->data()), size);
+            }
+            if (!out)
+            {
+                // The cache is an optimization; failing to store a synopsis is not an error.
+                ::unlink(tmp.str().c_str());
+                return;
+            }
+        }
+        if (::rename(tmp.str().c_str(), path.c_str()) != 0)
+        {
+            ::unlink(tmp.str().c_str());
+        }
+    }
+
+    std::shared_ptr<BCBetweenSynopsis const> BCBetweenZoneMap::get(AttributeID attrID, Coordinates const& chunkPos,
+                                                                   ConstChunk const& chunk)
+    {
+        Key key(attrID, chunkPos);
+        {
+            ScopedMutexLock cs(_mutex);
+            std::map<Key, std::shared_ptr<BCBetweenSynopsis const> >::const_iterator it = _synopses.find(key);
+            if (it != _synopses.end())
+            {
+                return it->second;
+            }
+        }
+
+        // Load or build outside the lock; another iterator may do the same meanwhile, with the same result.
+        std::shared_ptr<BCBetweenSynopsis const> synopsis;
+        if (!_dir.empty())
+        {
+            synopsis = load(key);
+        }
+        if (!synopsis)
+        {
+            synopsis = build(chunk);
+            if (!_dir.empty())
+            {
+                store(key, *synopsis);
+            }
+        }
+
+        ScopedMutexLock cs(_mutex);
+        if (_synopses.insert(std::make_pair(key, synopsis)).second)
+        {
+            _order.push_back(key);
+        }
+        while (_order.size() > MAX_SYNOPSES_IN_MEMORY)
+        {
+            _synopses.erase(_order.front());
+            _order.pop_front();
+        }
+        return synopsis;
+    }
+}
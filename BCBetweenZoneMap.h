@@ -0,0 +1,91 @@
+/*
+ * BCBetweenZoneMap.h
+ *
+ * Created on :Oct 18, 2026
+ */
+
+/**
+ * @file BCBetweenZoneMap.h
+ *
+ * @brief Per-chunk synopses of the bound attributes of bc_between.
+ *
+ * The storage of SciDB keeps no minimum and maximum per chunk, so a synopsis is built by one pass over
+ * the chunk, the first time a query reads it. Synopses are kept in memory for the running query, or for
+ * the next queries of the same shape with 'prepared=true', and, with 'cache_dir', stored on the local disk
+ * of every instance in <cache_dir>/zone_<hash>/, where the hash is that of the input array ID and version,
+ * one file per attribute and chunk position. A synopsis only depends on the payload of its chunk, so
+ * every query on the same version of the array shares it, whatever its window or expression.
+ */
+
+#ifndef BC_BETWEEN_ZONE_MAP_H_
+#define BC_BETWEEN_ZONE_MAP_H_
+
+#include <array/Array.h>
+#include <array/Metadata.h>
+#include <query/TypeSystem.h>
+#include <util/Mutex.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace scidb
+{
+    struct BCBetweenSynopsis
+    {
+        bool hasCells;      // the chunk has a non-null cell
+        bool hasNulls;      // the chunk has a null cell
+        bool constant;      // every non-null cell holds the same value, min
+        bool ordered;       // min and max are the smallest and largest values; numeric types without NaN only
+        Value min;
+        Value max;
+
+        BCBetweenSynopsis()
+                : hasCells(false),
+                  hasNulls(false),
+                  constant(true),
+                  ordered(false)
+        {
+        }
+    };
+
+    class BCBetweenZoneMap
+    {
+    public:
+        /**
+         * @param dir the cache directory, or empty to keep the synopses in memory only.
+         * @param key the text identifying the version of the input array.
+         */
+        BCBetweenZoneMap(std::string const& dir, std::string const& key);
+
+        /**
+         * The synopsis of the chunk of attrID at chunkPos, built from chunk if it is neither in memory
+         * nor on disk.
+         */
+        std::shared_ptr<BCBetweenSynopsis const> get(AttributeID attrID, Coordinates const& chunkPos, ConstChunk const& chunk);
+
+        /**
+         * One pass over the non-empty cells of chunk.
+         */
+        static std::shared_ptr<BCBetweenSynopsis const> build(ConstChunk const& chunk);
+
+    private:
+        typedef std::pair<AttributeID, Coordinates> Key;
+
+        std::string getPath(Key const& key) const;
+        std::shared_ptr<BCBetweenSynopsis const> load(Key const& key) const;
+        void store(Key const& key, BCBetweenSynopsis const& synopsis) const;
+
+        /**
+         * At most this many synopses are kept in memory; the oldest one is dropped first.
+         */
+        static const size_t MAX_SYNOPSES_IN_MEMORY = 1024;
+
+        std::string _dir;
+        std::map<Key, std::shared_ptr<BCBetweenSynopsis const> > _synopses;
+        std::deque<Key> _order;
+        Mutex _mutex;
+    };
+} //namespace
+
+#endif /* BC_BETWEEN_ZONE_MAP_H_ */
@@ -6,7 +6,9 @@
  */
 
 #include "query/Operator.h"
+#include "query/LogicalExpression.h"
 #include "system/Exceptions.h"
+#include "BCBetweenSettings.h"
 
 
 namespace scidb {
@@ -15,7 +17,7 @@ namespace scidb {
      * @brief The operator: bc_between().
      *
      * @par Synopsis:
-     *   bc_between( srcArray, boundary_expression, {, arrayLowCoord}+ {, arrayHighCoord}+ {, bc_flag})
+     *   bc_between( srcArray, boundary_expression, {, arrayLowCoord}+ {, arrayHighCoord}+ {, bc_flag}* {, 'key=value'}*)
      *
      * @par Summary:
      *   Boundary check between operator.
@@ -26,7 +28,65 @@ namespace scidb {
      *   - the array low coordinates : low coordinates of srcArray on each dimension.
      *   - the array high coordinates : high coordinates of srcArray on each dimension.
      *   - the boundary condition flag : flag whether adapting boundary condition or not. (Optional)
-     *                                   Default : True
+     *                                   Default : True on the first dimension, False on the others
+     *   - options : string parameters of the form 'key=value'. (Optional)
+     *     - 'shell_low=w0,w1,...' : thickness of the shell on the low side of each dimension.
+     *     - 'shell_high=w0,w1,...' : thickness of the shell on the high side of each dimension.
+     *                                Default : 1 where the boundary condition flag is set, 0 elsewhere
+     *     - 'patches=N' : sliding-window batch mode. Emit N windows, the first one given by the
+     *                     low and high coordinates, each following one shifted by the stride.
+     *     - 'stride=s0,s1,...' : shift between two consecutive patches on each dimension.
+     *                            Default : 0
+     *     - 'sample=r' : keep each cell that passes with probability r, without evaluating the
+     *                    boundary expression for the cells that are skipped.
+     *     - 'sample_size=K' : like 'sample', with r chosen so that K cells of the window are kept on average.
+     *     - 'seed=N' : seed of the sampling. The same seed always keeps the same cells.
+     *                  Default : 0
+     *     - 'export=prefix' : write every fixed-size attribute of the window as a row-major dense buffer
+     *                         into the local file prefix.<query>.<attribute>, the empty tag as a packed bit
+     *                         mask into prefix.<query>.mask, the nulls of every nullable attribute as a packed
+     *                         bit mask into prefix.<query>.<attribute>.nulls, and, once every instance is
+     *                         done, the shape, types and file names into prefix.json. Fails if the files do
+     *                         not fit on the file system of prefix. The operator then returns an empty array.
+     *     - 'neighbor=attr:d0,d1,...' : the boundary expression reads attr at the cell shifted by (d0, d1, ...).
+     *                                   Cells beyond the array or empty read as null. To compare a cell with
+     *                                   its neighbor, bind a copy of the attribute, e.g. apply(A, left, v).
+     *                                   Repeat the option for several attributes. On several instances,
+     *                                   the input must be replicated, since neighbors are read locally.
+     *     - 'complement=true' : return exactly the cells that bc_between would drop: the cells outside
+     *                           the window, and the shell cells that fail the boundary expression.
+     *     - 'ghost=periodic|reflect' : the window may reach beyond the array bounds. Cells out of the
+     *                                  bounds are filled from the opposite side of the array (periodic)
+     *                                  or from the mirror image across the bound (reflect). In the
+     *                                  shell they are kept only when the boundary expression passes on
+     *                                  the copied values at their own coordinates. Not supported with
+     *                                  'neighbor'.
+     *     - 'cache_dir=path' : keep the results of the boundary expression on the shell in the local
+     *                          directory path, and reuse them when the same stored array is queried with the
+     *                          same window and expression, for every chunk that did not change since.
+     *     - 'zone_map=constant|convex' : decide the boundary expression for a whole chunk from the minimum
+     *                                    and maximum of its bound attributes, kept per chunk in memory and
+     *                                    in cache_dir. With constant, a chunk is decided when every bound
+     *                                    attribute holds one value in it. With convex, also when the expression
+     *                                    passes at every corner of the min/max box; only give it when the
+     *                                    passing values form a convex set, e.g. for a conjunction of range checks.
+     *                                    Not used with coordinate or neighbor bindings.
+     *     - 'limit=K' : every instance returns at most K cells, from the chunks it reaches first, and then
+     *                   stops reading chunks. Not supported with patches, export or ghost cells.
+     *     - 'reorder=true' : when the boundary expression is a chain of 'and' or of 'or', evaluate its terms
+     *                        apart, cheapest and most decisive first, as measured on the first shell cells.
+     *     - 'prepared=true' : for queries that repeat the same expression and neighbors on the same stored array
+     *                         version with other windows. Each instance keeps the resolved bindings, the halos of
+     *                         the neighbor bindings, the zone map and the measured term order for the next such
+     *                         query with the same 'cache_dir', which only builds its window. SciDB still parses
+     *                         and plans every query. Not supported in patch mode.
+     *     - 'shared_scan=true' : the concurrent queries with this option on the same stored array version read each
+     *                            input chunk once per instance, and each filters it with its own window and expression.
+     *                            Not supported in patch mode.
+     *     - 'stats=true' : count the chunks, probes and cells the operator goes through, and report them
+     *                      in the SciDB log and through bc_between_stats() at the end of the query.
+     *     - 'trace=path' : record the phases of the chunk iteration with their threads, and write them to
+     *                      the local file path.<query>.<instance>.json in the Chrome trace format.
      *
      * @par Output array:
      *      <
@@ -36,6 +96,15 @@ namespace scidb {
      *          srcDims
      *      ]
      *
+     *   In patch mode, a trailing dimension 'patch' holds the patch index and srcDims have no overlap.
+     *   In ghost mode, srcDims are widened by whole chunks to hold the window, and have no chunk overlap.
+     *
+     * @par Plan-time estimate:
+     *   When the input is a stored array and no 'neighbor' is given, the optimizer reads up to 4 shell
+     *   chunks of the input while planning, to measure the pass rate of the boundary expression for the
+     *   output density. Only the chunks stored on the coordinator are read; if it holds none of the shell,
+     *   the whole shell is assumed to pass.
+     *
      */
     class LogicalBCBetween: public  LogicalOperator
     {
@@ -60,14 +129,23 @@ namespace scidb {
             } else
             {
                 res.push_back(END_OF_VARIES_PARAMS());
-                if(i < nDims * 3 + 1)
+                if(i < nDims * 3 + 1 && !isOption(i - 1))
                 {
                     res.push_back(PARAM_CONSTANT(TID_BOOL));
                 }
+                res.push_back(PARAM_CONSTANT(TID_STRING));
             }
             return res;
         }
 
+        /**
+         * Once the first 'key=value' option is given, no more boundary flags are accepted.
+         */
+        bool isOption(size_t i) const
+        {
+            return ((std::shared_ptr<OperatorParamLogicalExpression>&)_parameters[i])->getExpectedType().typeId() == TID_STRING;
+        }
+
         ArrayDesc inferSchema(std::vector< ArrayDesc> schemas, std::shared_ptr< Query> query)
         {
             assert(schemas.size() == 1);
@@ -75,10 +153,136 @@ namespace scidb {
             Dimensions const& dims = schemas[0].getDimensions();
             size_t nDims = dims.size();
             assert(_parameters.size() >= nDims * 2 + 1);
-            assert(_parameters.size() <= nDims * 3 + 1);
             assert(_parameters[0]->getParamType() == PARAM_LOGICAL_EXPRESSION);
 
-            return addEmptyTagAttribute(schemas[0]);
+            BCBetweenSettings settings(_parameters, true, query, nDims);
+            if (settings.isReordered() && !settings.hasTerms() && !settings.isPatchMode())
+            {
+                appendTerms();
+            }
+            ArrayDesc output = addEmptyTagAttribute(schemas[0]);
+            if (settings.isPatchMode())
+            {
+                return inferPatchSchema(output, settings, query);
+            }
+            if (settings.hasGhosts())
+            {
+                return inferGhostSchema(output, query);
+            }
+
+            return output;
+        }
+
+        /**
+         * For 'reorder=true', when the boundary expression is a chain of 'and' or of 'or', append
+         * '_terms=and' or '_terms=or', then every term of the chain as a boolean expression, so that
+         * the physical operator gets them compiled apart.
+         */
+        void appendTerms()
+        {
+            std::shared_ptr<OperatorParamLogicalExpression> const& param =
+                    (std::shared_ptr<OperatorParamLogicalExpression> const&)_parameters[0];
+            Function const* function = dynamic_cast<Function const*>(param->getExpression().get());
+            if (!function || (function->getFunction() != "and" && function->getFunction() != "or"))
+            {
+                return;
+            }
+
+            std::string const& op = function->getFunction();
+            std::vector<std::shared_ptr<LogicalExpression> > terms;
+            collectTerms(param->getExpression(), op, terms);
+
+            std::shared_ptr<ParsingContext> const& context = param->getParsingContext();
+            Value marker(TypeLibrary::getType(TID_STRING));
+            marker.setString("_terms=" + op);
+            _parameters.push_back(std::make_shared<OperatorParamLogicalExpression>(
+                    context, std::make_shared<Constant>(context, marker, TID_STRING),
+                    TypeLibrary::getType(TID_STRING), true));
+            for (size_t i = 0, n = terms.size(); i < n; i++)
+            {
+                _parameters.push_back(std::make_shared<OperatorParamLogicalExpression>(
+                        context, terms[i], TypeLibrary::getType(TID_BOOL), false));
+            }
+        }
+
+        static void collectTerms(std::shared_ptr<LogicalExpression> const& expression, std::string const& op,
+                                 std::vector<std::shared_ptr<LogicalExpression> >& terms)
+        {
+            Function* function = dynamic_cast<Function*>(expression.get());
+            if (function && function->getFunction() == op)
+            {
+                for (std::shared_ptr<LogicalExpression> const& arg : function->getArgs())
+                {
+                    collectTerms(arg, op, terms);
+                }
+            } else
+            {
+                terms.push_back(expression);
+            }
+        }
+
+        /**
+         * Append the patch dimension. Every input chunk becomes exactly one output chunk
+         * holding all of its patches, so the patch dimension is a single chunk.
+         */
+        ArrayDesc inferPatchSchema(ArrayDesc const& output, BCBetweenSettings const& settings, std::shared_ptr< Query> query)
+        {
+            Dimensions dims;
+            for (DimensionDesc const& dim : output.getDimensions())
+            {
+                if (dim.hasNameAndAlias("patch"))
+                {
+                    throw USER_EXCEPTION(SCIDB_SE_INFER_SCHEMA, SCIDB_LE_DUPLICATE_DIMENSION_NAME) << "patch";
+                }
+                dims.push_back(DimensionDesc(dim.getBaseName(), dim.getStartMin(), dim.getEndMax(), dim.getChunkInterval(), 0));
+            }
+            dims.push_back(DimensionDesc("patch", 0, settings.getPatchCount() - 1, settings.getPatchCount(), 0));
+
+            return ArrayDesc(output.getName(), output.getAttributes(), dims,
+                             createDistribution(psUndefined), query->getDefaultArrayResidency());
+        }
+
+        /**
+         * Widen every dimension to hold the window. The low bound moves by whole chunks,
+         * so the chunk grid of the output stays aligned with the input. The chunks are written
+         * anew without their overlaps, so the output has none.
+         */
+        ArrayDesc inferGhostSchema(ArrayDesc const& output, std::shared_ptr< Query> query)
+        {
+            Dimensions const& inputDims = output.getDimensions();
+            size_t nDims = inputDims.size();
+            Dimensions dims;
+            for (size_t i = 0; i < nDims; i++)
+            {
+                DimensionDesc const& dim = inputDims[i];
+                Coordinate start = dim.getStartMin();
+                Coordinate end = dim.getEndMax();
+                int64_t interval = dim.getChunkInterval();
+
+                Value const& low = evaluate(((std::shared_ptr<OperatorParamLogicalExpression>&)_parameters[i + 1])->getExpression(),
+                                            query, TID_INT64);
+                if (!low.isNull() && low.getInt64() < start)
+                {
+                    start -= (start - low.getInt64() + interval - 1) / interval * interval;
+                }
+                Value const& high = evaluate(((std::shared_ptr<OperatorParamLogicalExpression>&)_parameters[i + nDims + 1])->getExpression(),
+                                             query, TID_INT64);
+                if (!high.isNull() && high.getInt64() > end)
+                {
+                    end = high.getInt64();
+                }
+
+                DimensionDesc widened = dim;
+                widened.setStartMin(start);
+                widened.setCurrStart(start);
+                widened.setEndMax(end);
+                widened.setCurrEnd(end);
+                widened.setChunkOverlap(0);
+                dims.push_back(widened);
+            }
+
+            return ArrayDesc(output.getName(), output.getAttributes(), dims,
+                             createDistribution(psUndefined), query->getDefaultArrayResidency());
         }
     };
 
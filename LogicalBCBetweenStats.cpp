@@ -0,0 +1,68 @@
+/*
+ * LogicalBCBetweenStats.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include "query/Operator.h"
+#include "system/Exceptions.h"
+#include "BCBetweenStats.h"
+
+
+namespace scidb {
+
+    /**
+     * @brief The operator: bc_between_stats().
+     *
+     * @par Synopsis:
+     *   bc_between_stats()
+     *
+     * @par Summary:
+     *   The instrumentation counters of the bc_between queries run with 'stats=true',
+     *   as kept on every instance.
+     *
+     * @par Output array:
+     *      <
+     *          query_id : string
+     *          one uint64 attribute per counter : chunks_visited, chunks_fully_inside, ...
+     *      >
+     *      [
+     *          instance, n
+     *      ]
+     *
+     *   n numbers the reports of an instance, oldest first.
+     *
+     */
+    class LogicalBCBetweenStats: public  LogicalOperator
+    {
+    public:
+        LogicalBCBetweenStats(const std::string& logicalName, const std::string& alias) : LogicalOperator(logicalName, alias)
+        {
+        }
+
+        ArrayDesc inferSchema(std::vector< ArrayDesc> schemas, std::shared_ptr< Query> query)
+        {
+            assert(schemas.size() == 0);
+
+            Attributes attrs;
+            attrs.push_back(AttributeDesc(0, "query_id", TID_STRING, 0, 0));
+            for (size_t i = 0; i < BCBetweenStats::N_COUNTERS; i++)
+            {
+                attrs.push_back(AttributeDesc(safe_static_cast<AttributeID>(i + 1),
+                                              BCBetweenStats::getName(static_cast<BCBetweenStats::Counter>(i)),
+                                              TID_UINT64, 0, 0));
+            }
+
+            Dimensions dims;
+            dims.push_back(DimensionDesc("instance", 0, query->getInstancesCount() - 1, 1, 0));
+            dims.push_back(DimensionDesc("n", 0, BCBetweenStats::MAX_REPORTS - 1, BCBetweenStats::MAX_REPORTS, 0));
+
+            return addEmptyTagAttribute(ArrayDesc("bc_between_stats", attrs, dims,
+                                                  createDistribution(psUndefined), query->getDefaultArrayResidency()));
+        }
+    };
+
+    REGISTER_LOGICAL_OPERATOR_FACTORY(LogicalBCBetweenStats, "bc_between_stats");
+
+
+}  // namespace scidb
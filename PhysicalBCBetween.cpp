@@ -30,7 +30,13 @@
 #include <query/Operator.h>
 #include <array/Metadata.h>
 #include <array/Array.h>
+#include <array/MemArray.h>
 #include "BCBetweenArray.h"
+#include "BCBetweenExport.h"
+#include "BCBetweenGhostArray.h"
+#include "BCBetweenPatchArray.h"
+#include "BCBetweenSelectivity.h"
+#include "BCBetweenSettings.h"
 
 namespace scidb
 {
@@ -38,19 +44,41 @@ namespace scidb
     {
     public:
         PhysicalBCBetween(const std::string& logicalName, const std::string& physicalName, const Parameters& parameters, const ArrayDesc& schema):
-                PhysicalOperator(logicalName, physicalName, parameters, schema)
+                PhysicalOperator(logicalName, physicalName, parameters, schema),
+                _nInputDims(0),
+                _selectivity(-1)
         {
+            // The window coordinates are the only int64 parameters. In patch mode, _schema has one more dimension.
+            for (size_t i = 1, n = _parameters.size(); i < n; i++)
+            {
+                if (((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[i])->getExpression()->getType() != TID_INT64)
+                {
+                    break;
+                }
+                _nInputDims++;
+            }
+            _nInputDims /= 2;
+        }
+
+        size_t getInputDims() const
+        {
+            return _nInputDims;
         }
 
-        Coordinates getWindowStart(const std::shared_ptr<Query>& query) const
+        /**
+         * @param clamp whether to clamp the coordinates to the array bounds.
+         *              Patch mode needs the unclamped window to shift it.
+         *              In ghost mode, the bounds of _schema are already widened to hold the window.
+         */
+        Coordinates getWindowStart(const std::shared_ptr<Query>& query, bool clamp = true) const
         {
             Dimensions const& dims = _schema.getDimensions();
-            size_t nDims = dims.size();
+            size_t nDims = getInputDims();
             Coordinates result(nDims);
             for (size_t i = 0; i < nDims; i++)
             {
                 Value const& coord = ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[i + 1])->getExpression()->evaluate();
-                if ( coord.isNull() || coord.get<int64_t>() < dims[i].getStartMin())
+                if ( coord.isNull() || (clamp && coord.get<int64_t>() < dims[i].getStartMin()))
                 {
                     result[i] = dims[i].getStartMin();
                 }
@@ -62,15 +90,15 @@ namespace scidb
             return result;
         }
 
-        Coordinates getWindowEnd(const std::shared_ptr<Query>& query) const
+        Coordinates getWindowEnd(const std::shared_ptr<Query>& query, bool clamp = true) const
         {
             Dimensions const& dims = _schema.getDimensions();
-            size_t nDims = dims.size();
+            size_t nDims = getInputDims();
             Coordinates result(nDims);
             for (size_t i = 0; i < nDims; i++)
             {
                 Value const& coord = ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[i + nDims + 1])->getExpression()->evaluate();
-                if (coord.isNull() || coord.getInt64() > dims[i].getEndMax())
+                if (coord.isNull() || (clamp && coord.getInt64() > dims[i].getEndMax()))
                 {
                     result[i] = dims[i].getEndMax();
                 }
@@ -82,55 +110,151 @@ namespace scidb
             return result;
         }
 
-        Coordinates getInnerWindowStart(Coordinates const& input, bool const flags[]) const
+        Coordinates getInnerWindowStart(Coordinates const& input, Coordinates const& shellLow) const
         {
             size_t nDims = input.size();
             Coordinates result(nDims);
             for(size_t i = 0; i < nDims; i++)
             {
-                // For boundary check, increase all start coordinate value.
-                if(flags[i])
-                    result[i] = input[i] + 1;
-                else
-                    result[i] = input[i];
+                // For boundary check, increase all start coordinate value by the shell width.
+                result[i] = input[i] + shellLow[i];
             }
             return result;
         }
 
-        Coordinates getInnerWindowEnd(Coordinates const& input, bool const flags[]) const
+        Coordinates getInnerWindowEnd(Coordinates const& input, Coordinates const& shellHigh) const
         {
             size_t nDims = input.size();
             Coordinates result(nDims);
             for(size_t i = 0; i < nDims; i++)
             {
-                // For boundary check, decrease all end cooridnate value.
-                if(flags[i])
-                    result[i] = input[i] - 1;
-                else
-                    result[i] = input[i];
+                // For boundary check, decrease all end cooridnate value by the shell width.
+                result[i] = input[i] - shellHigh[i];
             }
             return result;
         }
 
-        void fillFlag(bool flags[])
+        virtual PhysicalBoundaries getOutputBoundaries(const std::vector<PhysicalBoundaries> & inputBoundaries,
+                                                       const std::vector< ArrayDesc> & inputSchemas) const
         {
-            Dimensions const& dims = _schema.getDimensions();
-            size_t nDims = dims.size();
-            size_t nPar = _parameters.size() - (nDims * 2 + 1);
+            std::shared_ptr<Query> query(Query::getValidQueryPtr(_query));
+            BCBetweenSettings settings(_parameters, false, query, getInputDims());
+            if (settings.isPatchMode())
+            {
+                return getPatchBoundaries(inputBoundaries[0], settings, query);
+            }
+            if (settings.isExport())
+            {
+                return PhysicalBoundaries::createEmpty(_schema.getDimensions().size());
+            }
+            if (settings.isComplement())
+            {
+                return inputBoundaries[0];
+            }
+            if (settings.hasGhosts())
+            {
+                return PhysicalBoundaries(getWindowStart(query), getWindowEnd(query));
+            }
 
-            for (size_t i = 0 ; i < nPar; i++)
+            Coordinates lowPos = getWindowStart(query);
+            Coordinates highPos = getWindowEnd(query);
+            PhysicalBoundaries window = inputBoundaries[0].intersectWith(PhysicalBoundaries(lowPos, highPos));
+            if (window.isEmpty())
             {
-                Value const& flag = ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[i + nDims * 2 + 1])->getExpression()->evaluate();
-                flags[i] = flag.getBool();
+                return window;
             }
+
+            double selectivity = getSelectivity(inputSchemas[0], settings, query);
+            if (settings.isSampled())
+            {
+                selectivity *= settings.getSampleRate(BCBetweenSelectivity::getVolume(lowPos, highPos));
+            }
+            return PhysicalBoundaries(window.getStartCoords(), window.getEndCoords(),
+                                      std::min(1.0, window.getDensity() * selectivity));
         }
 
-        virtual PhysicalBoundaries getOutputBoundaries(const std::vector<PhysicalBoundaries> & inputBoundaries,
-                                                       const std::vector< ArrayDesc> & inputSchemas) const
+        /**
+         * The expected fraction of the window that passes, measured once per plan.
+         * The pass rate of the shell is only measured on a stored input without neighbor bindings,
+         * since the expression then reads the stored attributes directly. It reads the chunks stored
+         * on the coordinator, at plan time.
+         */
+        double getSelectivity(ArrayDesc const& inputSchema,
+                              BCBetweenSettings const& settings,
+                              const std::shared_ptr<Query>& query) const
+        {
+            if (_selectivity < 0)
+            {
+                Coordinates lowPos = getWindowStart(query);
+                Coordinates highPos = getWindowEnd(query);
+                BCBetweenSelectivity estimator(inputSchema, lowPos, highPos,
+                                               getInnerWindowStart(lowPos, settings.getShellLow()),
+                                               getInnerWindowEnd(highPos, settings.getShellHigh()),
+                                               ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[0])->getExpression());
+                bool measure = inputSchema.getId() != 0 && !inputSchema.isTransient() && settings.getNeighbors().empty();
+                _selectivity = estimator.estimate(query, measure);
+            }
+            return _selectivity;
+        }
+
+        /**
+         * The output chunks are the input chunks, filtered in place, so the input distribution is kept.
+         * Patch and ghost modes build their chunks anew, with the undefined distribution of _schema.
+         */
+        virtual RedistributeContext getOutputDistribution(const std::vector<RedistributeContext> & inputDistributions,
+                                                          const std::vector< ArrayDesc> & inputSchemas) const
+        {
+            if (changesDistribution(inputSchemas))
+            {
+                return RedistributeContext(_schema.getDistribution(), _schema.getResidency());
+            }
+            return inputDistributions[0];
+        }
+
+        virtual bool changesDistribution(const std::vector< ArrayDesc> & inputSchemas) const
+        {
+            std::shared_ptr<Query> query(Query::getValidQueryPtr(_query));
+            BCBetweenSettings settings(_parameters, false, query, getInputDims());
+            return settings.isPatchMode() || settings.hasGhosts();
+        }
+
+        /**
+         * Every output chunk is built on the instance holding its input chunk, except in ghost mode,
+         * where several instances may contribute cells to the same chunk.
+         */
+        virtual bool outputFullChunks(const std::vector< ArrayDesc> & inputSchemas) const
         {
             std::shared_ptr<Query> query(Query::getValidQueryPtr(_query));
-            PhysicalBoundaries window(getWindowStart(query), getWindowEnd(query));
-            return inputBoundaries[0].intersectWith(window);
+            BCBetweenSettings settings(_parameters, false, query, getInputDims());
+            return !settings.hasGhosts();
+        }
+
+        /**
+         * The union of all patch windows, plus the patch dimension.
+         */
+        PhysicalBoundaries getPatchBoundaries(PhysicalBoundaries const& inputBoundaries,
+                                              BCBetweenSettings const& settings,
+                                              const std::shared_ptr<Query>& query) const
+        {
+            Coordinates lowPos = getWindowStart(query);
+            Coordinates highPos = getWindowEnd(query, false);
+            Coordinates const& stride = settings.getPatchStride();
+            Dimensions const& dims = _schema.getDimensions();
+            for (size_t i = 0, n = highPos.size(); i < n; i++)
+            {
+                highPos[i] = std::min(highPos[i] + (settings.getPatchCount() - 1) * stride[i], dims[i].getEndMax());
+            }
+
+            PhysicalBoundaries window = inputBoundaries.intersectWith(PhysicalBoundaries(lowPos, highPos));
+            if (window.isEmpty())
+            {
+                return PhysicalBoundaries::createEmpty(dims.size());
+            }
+            Coordinates start = window.getStartCoords();
+            Coordinates end = window.getEndCoords();
+            start.push_back(0);
+            end.push_back(settings.getPatchCount() - 1);
+            return PhysicalBoundaries(start, end);
         }
 
         /***
@@ -141,22 +265,34 @@ namespace scidb
         {
             assert(inputArrays.size() == 1);
 
-            Dimensions const& dims = _schema.getDimensions();
-            size_t nDims = dims.size();
+            size_t nDims = getInputDims();
             assert(_parameters.size() >= nDims * 2 + 1);
-            assert(_parameters.size() <= nDims * 3 + 1);
             assert(_parameters[0]->getParamType() == PARAM_PHYSICAL_EXPRESSION);
-            checkOrUpdateIntervals(_schema, inputArrays[0]);
 
-            bool flags[nDims] = { true, };
-            fillFlag(flags);
+            BCBetweenSettings settings(_parameters, false, query, nDims);
             std::shared_ptr<Array> inputArray = ensureRandomAccess(inputArrays[0], query);
 
+            if (settings.isPatchMode())
+            {
+                return std::shared_ptr<Array>(
+                        make_shared<BCBetweenPatchArray>(
+                                _schema,
+                                inputArray,
+                                getWindowStart(query, false),
+                                getWindowEnd(query, false),
+                                settings.getPatchStride(),
+                                settings.getPatchCount(),
+                                settings.getShellLow(),
+                                settings.getShellHigh(),
+                                ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[0])->getExpression(), query));
+            }
+            checkOrUpdateIntervals(_schema, inputArrays[0]);
+
             Coordinates lowPos = getWindowStart(query);
             Coordinates highPos = getWindowEnd(query);
 
-            Coordinates innerLowPos = getInnerWindowStart(lowPos, flags);
-            Coordinates innerHighPos = getInnerWindowEnd(highPos, flags);
+            Coordinates innerLowPos = getInnerWindowStart(lowPos, settings.getShellLow());
+            Coordinates innerHighPos = getInnerWindowEnd(highPos, settings.getShellHigh());
 
             SpatialRangesPtr spatialRangesPtr = make_shared<SpatialRanges>(lowPos.size());
             SpatialRangesPtr innerSpatialRangesPtr = make_shared<SpatialRanges>(innerLowPos.size());
@@ -171,14 +307,43 @@ namespace scidb
                 spatialRangesPtr->insert(SpatialRange(lowPos, highPos));
                 spatialRangesPtr->buildIndex();
             }
-            return std::shared_ptr<Array>(
+            std::shared_ptr<Array> result(
                     make_shared<BCBetweenArray>(
                             _schema,
                             spatialRangesPtr,
                             innerSpatialRangesPtr,
                             inputArray,
-                            ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[0])->getExpression(), query, _tileMode));
+                            ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[0])->getExpression(), query, _tileMode,
+                            settings));
+
+            if (settings.isExport())
+            {
+                BCBetweenExporter exporter(std::static_pointer_cast<BCBetweenArray>(result), lowPos, highPos,
+                                           settings.getExportPrefix(), query);
+                exporter.exportWindow();
+
+                // The description names the files once every instance has written its chunks into them.
+                syncBarrier(0, query);
+                if (query->isCoordinator())
+                {
+                    exporter.writeDescription();
+                }
+                return std::shared_ptr<Array>(make_shared<MemArray>(_schema, query));
+            }
+            if (settings.hasGhosts())
+            {
+                return std::shared_ptr<Array>(
+                        make_shared<BCBetweenGhostArray>(_schema, result, inputArray, lowPos, highPos,
+                                                         innerLowPos, innerHighPos,
+                                                         ((std::shared_ptr<OperatorParamPhysicalExpression>&)_parameters[0])->getExpression(),
+                                                         settings.getGhostMode(), query));
+            }
+            return result;
         }
+
+    private:
+        size_t _nInputDims;
+        mutable double _selectivity;
     };
 
     REGISTER_PHYSICAL_OPERATOR_FACTORY(PhysicalBCBetween, "bc_between", "PhysicalBCBetween");
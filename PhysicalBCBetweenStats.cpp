@@ -0,0 +1,77 @@
+/*
+ * PhysicalBCBetweenStats.cpp
+ *
+ * Created on :Oct 18, 2026
+ */
+
+#include <query/Operator.h>
+#include <array/Metadata.h>
+#include <array/MemArray.h>
+#include "BCBetweenStats.h"
+
+namespace scidb
+{
+    class PhysicalBCBetweenStats: public  PhysicalOperator
+    {
+    public:
+        PhysicalBCBetweenStats(const std::string& logicalName, const std::string& physicalName, const Parameters& parameters, const ArrayDesc& schema):
+                PhysicalOperator(logicalName, physicalName, parameters, schema)
+        {
+        }
+
+        /***
+         * Every instance returns its own reports, in the chunk of its instance coordinate.
+         */
+        std::shared_ptr< Array> execute(std::vector< std::shared_ptr< Array> >& inputArrays,
+                                        std::shared_ptr<Query> query)
+        {
+            assert(inputArrays.size() == 0);
+
+            std::shared_ptr<Array> result = std::make_shared<MemArray>(_schema, query);
+            std::vector<BCBetweenStats::Report> reports = BCBetweenStats::getReports();
+            if (reports.empty())
+            {
+                return result;
+            }
+
+            Coordinates pos(2);
+            pos[0] = query->getInstanceID();
+            pos[1] = 0;
+            Attributes const& attrs = _schema.getAttributes();
+            for (size_t i = 0, n = attrs.size(); i < n; i++)
+            {
+                std::shared_ptr<ArrayIterator> arrayIterator = result->getIterator(attrs[i].getId());
+                int mode = ChunkIterator::SEQUENTIAL_WRITE;
+                if (!attrs[i].isEmptyIndicator())
+                {
+                    mode |= ChunkIterator::NO_EMPTY_CHECK;
+                }
+                std::shared_ptr<ChunkIterator> chunkIterator = arrayIterator->newChunk(pos).getIterator(query, mode);
+
+                Value value(TypeLibrary::getType(attrs[i].getType()));
+                for (size_t r = 0, m = reports.size(); r < m; r++)
+                {
+                    Coordinates cellPos(pos);
+                    cellPos[1] = r;
+                    if (attrs[i].isEmptyIndicator())
+                    {
+                        value.setBool(true);
+                    } else if (i == 0)
+                    {
+                        value.setString(reports[r].queryID);
+                    } else
+                    {
+                        value.setUint64(reports[r].values[i - 1]);
+                    }
+                    chunkIterator->setPosition(cellPos);
+                    chunkIterator->writeItem(value);
+                }
+                chunkIterator->flush();
+            }
+            return result;
+        }
+    };
+
+    REGISTER_PHYSICAL_OPERATOR_FACTORY(PhysicalBCBetweenStats, "bc_between_stats", "PhysicalBCBetweenStats");
+
+}  // namespace scidb